@@ -0,0 +1,122 @@
+#ifndef CODE_POINTS_HPP
+#define CODE_POINTS_HPP
+
+#include "normalize.hpp"
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <string_view>
+#include <cstddef>
+
+namespace json {
+
+// lazy range of code points of escaped json string, nothing is written and decoding stops when the caller stops
+// raw utf-8 is fully validated same as with utf-16/utf-32 output, which is stricter than normalizing into utf-8
+class code_point_view: public std::ranges::view_interface<code_point_view> {
+	const char * first{nullptr};
+	const char * last{nullptr};
+
+public:
+	struct sentinel { };
+
+	class iterator {
+		const char * current{nullptr};
+		const char * end{nullptr};
+		char32_t value{0};
+		bool done{false};
+
+		constexpr void read_next() {
+			auto in = const_string_reader(std::string_view(current, end));
+
+			if (in.is_end()) [[unlikely]] {
+				throw std::invalid_argument("unexpected end");
+			}
+
+			const char c = in.peek();
+
+			// end of string
+			if (c == '"') [[unlikely]] {
+				done = true;
+				return;
+			}
+
+			// json string escape
+			if (c == '\\') [[unlikely]] {
+				value = read_escape(in);
+			} else {
+				const uint8_t number_of_additional_bytes = additional_length_of(static_cast<char8_t>(c));
+
+				// number of bytes of code_point + current + end quote, otherwise we can end
+				if (!in.has_at_least(number_of_additional_bytes + 2u)) [[unlikely]] {
+					throw std::invalid_argument("not enough space");
+				}
+
+				value = read_utf8_codepoint(in, number_of_additional_bytes);
+			}
+
+			current = in.current;
+		}
+
+	public:
+		using iterator_concept = std::input_iterator_tag;
+		using value_type = char32_t;
+		using difference_type = std::ptrdiff_t;
+
+		constexpr iterator() noexcept = default;
+
+		constexpr iterator(const char * begin, const char * e): current{begin}, end{e} {
+			read_next();
+		}
+
+		constexpr char32_t operator*() const noexcept {
+			assert(!done);
+			return value;
+		}
+
+		constexpr iterator & operator++() {
+			read_next();
+			return *this;
+		}
+
+		constexpr void operator++(int) {
+			read_next();
+		}
+
+		// position right after the current code point (or at end quote)
+		constexpr const char * position() const noexcept {
+			return current;
+		}
+
+		constexpr friend bool operator==(const iterator & it, sentinel) noexcept {
+			return it.done;
+		}
+	};
+
+	constexpr code_point_view() noexcept = default;
+
+	// input is content of the string right after opening quote
+	constexpr code_point_view(const char * begin, const char * end) noexcept: first{begin}, last{end} { }
+
+	constexpr iterator begin() const {
+		return iterator(first, last);
+	}
+
+	constexpr sentinel end() const noexcept {
+		return {};
+	}
+};
+
+constexpr auto code_points(std::string_view raw_json_string) noexcept -> std::optional<code_point_view> {
+	auto in = const_string_reader(raw_json_string);
+
+	if (!in.read_character('"')) {
+		return std::nullopt;
+	}
+
+	return code_point_view(in.current, in.end);
+}
+
+} // namespace json
+
+#endif
@@ -4,6 +4,8 @@
 #include "normalize.hpp"
 #include <random>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <cstddef>
 #include <array>
 #include <iostream>
@@ -122,4 +124,29 @@ std::string generate_random_json_string_with_length(size_t bytes) {
 	return output;
 }
 
+// object keys as they usually look like (with few escaped ones), already quoted
+std::vector<std::string> generate_json_keys(size_t count) {
+	const auto prefixes = std::array<std::string_view, 12>{"user", "order", "item", "price", "name", "created", "updated", "status", "type", "parent", "customer", "address"};
+	const auto suffixes = std::array<std::string_view, 8>{"id", "at", "name", "count", "url", "code", "caf\\u00e9", "a\\/b"};
+
+	std::vector<std::string> output;
+	output.reserve(count);
+
+	for (size_t i = 0; output.size() != count; ++i) {
+		std::string key = "\"";
+		key += prefixes[i % prefixes.size()];
+		key += "_";
+		key += suffixes[(i / prefixes.size()) % suffixes.size()];
+
+		if (const size_t round = i / (prefixes.size() * suffixes.size()); round != 0u) {
+			key += std::to_string(round);
+		}
+
+		key += "\"";
+		output.push_back(std::move(key));
+	}
+
+	return output;
+}
+
 #endif
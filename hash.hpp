@@ -0,0 +1,245 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include "normalize.hpp"
+#include <algorithm>
+#include <bit>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace json {
+
+constexpr auto hash_secret = std::array<uint64_t, 4>{0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+// wyhash style mixing: 64x64 -> 128 multiplication folded back to 64 bits
+constexpr uint64_t wymix(uint64_t a, uint64_t b) noexcept {
+	const auto r = static_cast<unsigned __int128>(a) * b;
+	return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64u);
+}
+
+// incremental hash, bytes can be fed in any chunks and the result will be same as for whole string at once
+class string_hasher {
+	uint64_t state;
+	uint64_t buffer{0};
+	size_t length{0};
+
+	constexpr void consume(uint64_t word) noexcept {
+		state = wymix(word ^ hash_secret[0], state ^ hash_secret[1]);
+	}
+
+public:
+	explicit constexpr string_hasher(uint64_t seed = 0u) noexcept: state{seed ^ hash_secret[2]} { }
+
+	constexpr void update(const char * first, const char * last) noexcept {
+		while (first != last) {
+			const size_t used = length % word_size;
+			const size_t n = std::min(static_cast<size_t>(std::distance(first, last)), word_size - used);
+
+			// whole words are loaded at once, short pieces (code points) are shifted into the buffer
+			uint64_t value = 0u;
+			if (n == word_size) {
+				value = load_word(first);
+			} else {
+				for (size_t i = 0; i != n; ++i) {
+					value |= static_cast<uint64_t>(static_cast<uint8_t>(first[i])) << (i * 8u);
+				}
+			}
+
+			buffer |= value << (used * 8u);
+			first += n;
+			length += n;
+
+			if ((length % word_size) == 0u) {
+				consume(buffer);
+				buffer = 0u;
+			}
+		}
+	}
+
+	constexpr void update(char c) noexcept {
+		update(&c, &c + 1);
+	}
+
+	constexpr void operator()(const char * first, const char * last) noexcept {
+		update(first, last);
+	}
+
+	constexpr uint64_t finalize() const noexcept {
+		uint64_t result = state;
+
+		if ((length % word_size) != 0u) {
+			result = wymix(buffer ^ hash_secret[0], result ^ hash_secret[1]);
+		}
+
+		return wymix(result ^ hash_secret[3], static_cast<uint64_t>(length) ^ hash_secret[1]);
+	}
+};
+
+constexpr uint64_t hash_string(std::string_view in, uint64_t seed = 0u) noexcept {
+	auto hasher = string_hasher{seed};
+	hasher.update(in.data(), in.data() + in.size());
+	return hasher.finalize();
+}
+
+struct hashed_string_view {
+	std::string_view view;
+	uint64_t hash;
+};
+
+// normalize and hash output in the same pass (hash is same as hash_string of the result)
+template <bool Branchless = false> [[gnu::flatten]] constexpr auto read_and_normalize_string_with_hash(string_reader & in, std::span<char> output) -> std::optional<hashed_string_view> {
+	auto hasher = string_hasher{};
+	const char * hashed = output.data();
+
+	// hash output in small blocks as soon as they are written and still in L1 (block is a multiple of a word so the branch is rarely taken)
+	constexpr ptrdiff_t block_size = 64;
+
+	const auto result = read_and_normalize_string<Branchless>(in, output, [&](const char *, const char * written) {
+		if (std::distance(hashed, written) >= block_size) [[unlikely]] {
+			hasher.update(hashed, hashed + block_size);
+			hashed += block_size;
+		}
+	});
+
+	if (!result) {
+		return std::nullopt;
+	}
+
+	hasher.update(hashed, result->data() + result->size());
+	return hashed_string_view{*result, hasher.finalize()};
+}
+
+template <bool Branchless = false> [[gnu::flatten]] constexpr auto read_and_normalize_string_with_hash(string_reader & in) -> std::optional<hashed_string_view> {
+	return read_and_normalize_string_with_hash<Branchless>(in, in.writable_rest());
+}
+
+// compile-time perfect hash (hash and displace) of known keys, lookup is one hash, one mix and one compare
+template <size_t N> class key_set {
+public:
+	static constexpr size_t capacity = std::bit_ceil(N * 2u + 1u);
+	static constexpr size_t bucket_count = std::bit_ceil(N / 4u + 1u);
+
+private:
+	static constexpr uint32_t empty_slot = 0u;
+	static constexpr uint32_t max_displacement = 1u << 20u;
+
+	std::array<std::string_view, N> keys{};
+	std::array<uint32_t, bucket_count> displacements{};
+	std::array<uint32_t, capacity> slots{}; // index of key + 1
+
+	static constexpr size_t bucket_of(uint64_t hash) noexcept {
+		return static_cast<size_t>(hash >> 32u) & (bucket_count - 1u);
+	}
+
+	static constexpr size_t slot_of(uint64_t hash, uint32_t displacement) noexcept {
+		return static_cast<size_t>(wymix(hash ^ displacement, hash_secret[3])) & (capacity - 1u);
+	}
+
+public:
+	consteval explicit key_set(const std::array<std::string_view, N> & in): keys{in} {
+		std::array<uint64_t, N> hashes{};
+
+		for (size_t i = 0; i != N; ++i) {
+			hashes[i] = hash_string(keys[i]);
+
+			for (size_t j = 0; j != i; ++j) {
+				if (keys[i] == keys[j]) {
+					throw std::invalid_argument("duplicate key");
+				}
+			}
+		}
+
+		std::array<size_t, bucket_count> bucket_sizes{};
+		for (size_t i = 0; i != N; ++i) {
+			++bucket_sizes[bucket_of(hashes[i])];
+		}
+
+		// place biggest buckets first as they are hardest to place
+		std::array<bool, bucket_count> placed{};
+
+		for (size_t round = 0; round != bucket_count; ++round) {
+			size_t bucket = 0;
+			for (size_t b = 0; b != bucket_count; ++b) {
+				if (!placed[b] && (placed[bucket] || bucket_sizes[b] > bucket_sizes[bucket])) {
+					bucket = b;
+				}
+			}
+
+			placed[bucket] = true;
+
+			if (bucket_sizes[bucket] == 0u) {
+				continue;
+			}
+
+			for (uint32_t d = 0;; ++d) {
+				if (d == max_displacement) {
+					throw std::invalid_argument("unable to find perfect hash");
+				}
+
+				auto candidate = slots;
+				bool success = true;
+
+				for (size_t i = 0; i != N && success; ++i) {
+					if (bucket_of(hashes[i]) != bucket) {
+						continue;
+					}
+
+					auto & slot = candidate[slot_of(hashes[i], d)];
+					success = (slot == empty_slot);
+					slot = static_cast<uint32_t>(i + 1u);
+				}
+
+				if (success) {
+					slots = candidate;
+					displacements[bucket] = d;
+					break;
+				}
+			}
+		}
+	}
+
+	static constexpr size_t size() noexcept {
+		return N;
+	}
+
+	constexpr std::string_view operator[](size_t index) const noexcept {
+		assert(index < N);
+		return keys[index];
+	}
+
+	// returns index of the key in original order
+	constexpr auto find(std::string_view key, uint64_t hash) const noexcept -> std::optional<size_t> {
+		const uint32_t slot = slots[slot_of(hash, displacements[bucket_of(hash)])];
+
+		if (slot == empty_slot) {
+			return std::nullopt;
+		}
+
+		if (keys[slot - 1u] != key) {
+			return std::nullopt;
+		}
+
+		return slot - 1u;
+	}
+
+	constexpr auto find(const hashed_string_view & key) const noexcept -> std::optional<size_t> {
+		return find(key.view, key.hash);
+	}
+
+	constexpr auto find(std::string_view key) const noexcept -> std::optional<size_t> {
+		return find(key, hash_string(key));
+	}
+};
+
+template <typename... Keys> consteval auto make_key_set(const Keys &... keys) {
+	return key_set<sizeof...(Keys)>{std::array<std::string_view, sizeof...(Keys)>{std::string_view(keys)...}};
+}
+
+} // namespace json
+
+#endif
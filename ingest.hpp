@@ -0,0 +1,318 @@
+#ifndef INGEST_HPP
+#define INGEST_HPP
+
+#include "normalize.hpp"
+#include <coroutine>
+#include <exception>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace json {
+
+// fire-and-forget coroutine, it starts immediately and its frame is destroyed when it finishes
+struct detached_task {
+	struct promise_type {
+		detached_task get_return_object() noexcept {
+			return {};
+		}
+
+		std::suspend_never initial_suspend() noexcept {
+			return {};
+		}
+
+		std::suspend_never final_suspend() noexcept {
+			return {};
+		}
+
+		void return_void() noexcept { }
+
+		// errors must be handled inside of the coroutine
+		void unhandled_exception() noexcept {
+			std::terminate();
+		}
+	};
+};
+
+// epoll based loop which resumes coroutines waiting for readable file descriptors
+class event_loop {
+	int epoll_fd;
+	size_t waiting{0};
+
+	void wait_for_readable(int fd, std::coroutine_handle<> handle) {
+		epoll_event ev{};
+		ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+		ev.data.ptr = handle.address();
+
+		// one-shot registration is re-armed, it's added only for first time
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) != 0) {
+			if (errno != ENOENT || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+				throw std::system_error(errno, std::system_category(), "epoll_ctl");
+			}
+		}
+
+		++waiting;
+	}
+
+public:
+	struct readable_awaiter {
+		event_loop & loop;
+		int fd;
+
+		constexpr bool await_ready() const noexcept {
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) {
+			loop.wait_for_readable(fd, handle);
+		}
+
+		constexpr void await_resume() const noexcept { }
+	};
+
+	event_loop(): epoll_fd{epoll_create1(EPOLL_CLOEXEC)} {
+		if (epoll_fd < 0) {
+			throw std::system_error(errno, std::system_category(), "epoll_create1");
+		}
+	}
+
+	event_loop(const event_loop &) = delete;
+	event_loop & operator=(const event_loop &) = delete;
+
+	~event_loop() {
+		close(epoll_fd);
+	}
+
+	readable_awaiter readable(int fd) noexcept {
+		return {*this, fd};
+	}
+
+	void forget(int fd) noexcept {
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+
+	size_t pending() const noexcept {
+		return waiting;
+	}
+
+	// runs until nobody waits
+	void run() {
+		std::array<epoll_event, 256> events;
+
+		while (waiting != 0u) {
+			const int n = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), -1);
+
+			if (n < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				throw std::system_error(errno, std::system_category(), "epoll_wait");
+			}
+
+			for (int i = 0; i != n; ++i) {
+				--waiting;
+				std::coroutine_handle<>::from_address(events[static_cast<size_t>(i)].data.ptr).resume();
+			}
+		}
+	}
+};
+
+constexpr bool is_json_whitespace(char c) noexcept {
+	return (c == ' ') | (c == '\n') | (c == '\r') | (c == '\t');
+}
+
+// end of the longest prefix of string content without end quote, where no escape or utf-8 sequence is cut in half
+// content is not validated here (normalization does it), unicode escape of hi-surrogate is taken together with following lo-surrogate
+constexpr const char * complete_prefix_end(const char * current, const char * end) noexcept {
+	for (;;) {
+		// skip ascii without quote or escape word by word
+		while (static_cast<size_t>(std::distance(current, end)) >= word_size && stop_mask(load_word(current)) == 0u) {
+			current += word_size;
+		}
+
+		if (current == end || *current == '"') {
+			return current;
+		}
+
+		const auto available = static_cast<size_t>(std::distance(current, end));
+		size_t length = additional_length_of(static_cast<char8_t>(*current)) + 1u;
+
+		if (*current == '\\') {
+			length = 2u;
+
+			if (available >= 2u && current[1] == 'u') {
+				length = 6u;
+
+				if (available >= 4u && (current[2] == 'd' || current[2] == 'D')) {
+					const int8_t second = hexdec_table[static_cast<uint8_t>(current[3])];
+					length = (second >= 8 && second <= 0xB) ? 12u : 6u;
+				}
+			}
+		}
+
+		if (available < length) {
+			return current;
+		}
+
+		current += length;
+	}
+}
+
+// normalizes (in place) string content from first up to `until`, which is at end quote or at the end of complete prefix
+// byte at `until` must be readable, returns end of the output
+inline char * normalize_string_content(char * first, char * until) {
+	auto in = string_reader(std::span<char>(first, until + 1));
+	auto observer = no_observer{};
+	char * writer = first;
+
+	while (in.current < until && normalize_word_or_code_point<false, case_folding::none>(in, writer, observer)) { }
+
+	return writer;
+}
+
+// normalizes json strings (optionally separated by whitespace) of a stream as its bytes arrive
+// string inside of one chunk is normalized in place, longer strings are assembled from normalized parts of each chunk
+class stream_normalizer {
+	std::string pending;
+	bool unfinished{false};
+
+public:
+	// normalizes (in place) everything which is available and calls on_string for each complete string
+	// returns size of incomplete tail (at most one escape or utf-8 sequence), which is moved to the front of the buffer
+	template <typename OnString> size_t normalize_available(std::span<char> buffer, OnString & on_string) {
+		char * current = buffer.data();
+		char * const end = buffer.data() + buffer.size();
+
+		for (;;) {
+			if (!unfinished) {
+				while (current != end && is_json_whitespace(*current)) {
+					++current;
+				}
+
+				if (current == end) {
+					break;
+				}
+
+				if (*current != '"') [[unlikely]] {
+					throw std::invalid_argument("expected string");
+				}
+
+				// whole string is here, so it's normalized in place without any copy
+				if (const char * const quote = find_end_quote(current + 1, end)) {
+					char * const after = current + std::distance(const_cast<const char *>(current), quote) + 1;
+
+					auto reader = string_reader(std::span<char>(current, after));
+					const auto view = read_and_normalize_string(reader);
+					assert(view.has_value());
+
+					on_string(*view);
+					current = after;
+					continue;
+				}
+
+				unfinished = true;
+				pending.clear();
+				++current;
+			}
+
+			// rest of unfinished string
+			if (const char * const quote = find_end_quote(current, end)) {
+				char * const until = current + std::distance(const_cast<const char *>(current), quote);
+				pending.append(current, normalize_string_content(current, until));
+				unfinished = false;
+
+				on_string(std::string_view(pending));
+				current = until + 1;
+				continue;
+			}
+
+			if (current == end) {
+				break;
+			}
+
+			// byte after the prefix must be readable, so the prefix never ends at end of the buffer
+			char * const until = current + std::distance(const_cast<const char *>(current), complete_prefix_end(current, end - 1));
+			pending.append(current, normalize_string_content(current, until));
+			current = until;
+			break;
+		}
+
+		const auto rest = static_cast<size_t>(std::distance(current, end));
+		std::memmove(buffer.data(), current, rest);
+		return rest;
+	}
+
+	// end of input is valid only between strings
+	bool is_inside_string() const noexcept {
+		return unfinished;
+	}
+};
+
+// reads json strings from a socket and normalizes them as their bytes arrive
+// connection uses one small buffer, strings longer than the buffer are assembled in separate string (see stream_normalizer)
+// on_close is called with nullptr at the end of input or with the error
+template <typename OnString, typename OnClose> detached_task ingest_strings(event_loop & loop, int fd, OnString on_string, OnClose on_close, size_t buffer_size = 4096u) {
+	std::exception_ptr error;
+
+	try {
+		const int flags = fcntl(fd, F_GETFL);
+
+		if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+			throw std::system_error(errno, std::system_category(), "fcntl");
+		}
+
+		std::vector<char> buffer(buffer_size);
+		auto normalizer = stream_normalizer{};
+		size_t filled = 0;
+		bool eof = false;
+
+		while (!eof) {
+			co_await loop.readable(fd);
+
+			// read everything available (as long as there is space)
+			while (filled != buffer.size()) {
+				const ssize_t r = read(fd, buffer.data() + filled, buffer.size() - filled);
+
+				if (r > 0) {
+					filled += static_cast<size_t>(r);
+				} else if (r == 0) {
+					eof = true;
+					break;
+				} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					break;
+				} else if (errno != EINTR) {
+					throw std::system_error(errno, std::system_category(), "read");
+				}
+			}
+
+			filled = normalizer.normalize_available(std::span<char>(buffer.data(), filled), on_string);
+
+			// only an incomplete escape or utf-8 sequence is kept
+			if (filled == buffer.size()) {
+				throw std::length_error("connection buffer is too small");
+			}
+		}
+
+		if (filled != 0u || normalizer.is_inside_string()) {
+			throw std::invalid_argument("unexpected end");
+		}
+	} catch (...) {
+		error = std::current_exception();
+	}
+
+	loop.forget(fd);
+	on_close(error);
+}
+
+} // namespace json
+
+#endif
@@ -0,0 +1,118 @@
+#include "ingest.hpp"
+#include <algorithm>
+#include <chrono>
+#include <charconv>
+#include <string>
+#include <thread>
+#include <vector>
+#include <array>
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <iostream>
+
+using clock_type = std::chrono::steady_clock;
+
+uint64_t now_ns() {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now().time_since_epoch()).count());
+}
+
+// as many connections as we can get file descriptors for
+int max_connections(int wanted) {
+	rlimit limit{};
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+	getrlimit(RLIMIT_NOFILE, &limit);
+
+	// two descriptors per connection and some of them are left for everything else, limit can be also RLIM_INFINITY
+	constexpr rlim_t reserved = 64u;
+	const rlim_t available = (limit.rlim_cur > reserved) ? (limit.rlim_cur - reserved) / 2u : 0u;
+
+	return static_cast<int>(std::min(static_cast<rlim_t>(std::max(wanted, 0)), available));
+}
+
+bool write_all(int fd, std::string_view data) {
+	while (!data.empty()) {
+		const ssize_t r = write(fd, data.data(), data.size());
+		if (r < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data.remove_prefix(static_cast<size_t>(r));
+	}
+	return true;
+}
+
+int main(int argc, char ** argv) {
+	const int connections = max_connections(argc > 1 ? std::stoi(argv[1]) : 4000);
+	const int messages_per_connection = argc > 2 ? std::stoi(argv[2]) : 100;
+
+	std::vector<std::array<int, 2>> sockets(static_cast<size_t>(connections));
+	for (auto & pair: sockets) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair.data()) != 0) {
+			std::cout << "socketpair failed: " << std::strerror(errno) << "\n";
+			return 1;
+		}
+	}
+
+	auto loop = json::event_loop{};
+	std::vector<uint64_t> latencies;
+	latencies.reserve(static_cast<size_t>(connections) * static_cast<size_t>(messages_per_connection));
+	int errors = 0;
+
+	// each message ends with its send time, so latency is known when it's normalized
+	const auto on_string = [&](std::string_view str) {
+		const auto digits = str.substr(str.rfind(' ') + 1u);
+		uint64_t sent = 0;
+		std::from_chars(digits.data(), digits.data() + digits.size(), sent);
+		latencies.push_back(now_ns() - sent);
+	};
+
+	const auto on_close = [&](std::exception_ptr error) {
+		errors += (error != nullptr);
+	};
+
+	for (const auto & pair: sockets) {
+		json::ingest_strings(loop, pair[0], on_string, on_close);
+	}
+
+	const auto start = clock_type::now();
+
+	std::jthread sender([&] {
+		for (int m = 0; m != messages_per_connection; ++m) {
+			for (const auto & pair: sockets) {
+				const auto message = std::string(R"("user_id café 😀 sent at )") + std::to_string(now_ns()) + "\"\n";
+				write_all(pair[1], message);
+			}
+		}
+
+		for (const auto & pair: sockets) {
+			close(pair[1]);
+		}
+	});
+
+	loop.run();
+	sender.join();
+
+	const auto end = clock_type::now();
+
+	for (const auto & pair: sockets) {
+		close(pair[0]);
+	}
+
+	const double seconds = std::chrono::duration<double>(end - start).count();
+	std::sort(latencies.begin(), latencies.end());
+
+	const auto percentile = [&](double p) {
+		return latencies.empty() ? 0.0 : static_cast<double>(latencies[static_cast<size_t>(p * static_cast<double>(latencies.size() - 1u))]) / 1000.0;
+	};
+
+	std::cout << connections << " connections, " << latencies.size() << " messages in " << seconds << " s (" << (errors ? "with errors" : "no errors") << ")\n";
+	std::cout << "throughput: " << (static_cast<double>(latencies.size()) / seconds) << " messages/s\n";
+	std::cout << "latency p50: " << percentile(0.5) << " us, p99: " << percentile(0.99) << " us\n";
+
+	return errors != 0;
+}
@@ -0,0 +1,237 @@
+#ifndef INTERN_HPP
+#define INTERN_HPP
+
+#include "hash.hpp"
+#include "normalize.hpp"
+#include <atomic>
+#include <bit>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+namespace json {
+
+// thread-safe cache of normalized strings keyed by their raw (escaped) form, so repeated keys are decoded only once
+// lookups are lock-free, insertion locks one shard only, interned strings live as long as the cache
+class intern_cache {
+	static constexpr size_t shard_bits = 6u;
+	static constexpr size_t shard_count = size_t{1} << shard_bits;
+	static constexpr size_t stripe_count = 64u;
+	static constexpr size_t initial_capacity = 16u;
+
+	struct entry {
+		uint64_t hash;
+		std::string raw;
+		std::string normalized;
+	};
+
+	// open-addressing table with linear probing, slots are only filled (never removed) so readers don't need a lock
+	struct table {
+		size_t mask;
+		std::unique_ptr<std::atomic<const entry *>[]> slots;
+
+		explicit table(size_t capacity): mask{capacity - 1u}, slots{std::make_unique<std::atomic<const entry *>[]>(capacity)} {
+			assert(std::has_single_bit(capacity));
+		}
+
+		const entry * find(uint64_t hash, std::string_view raw) const noexcept {
+			for (size_t i = hash & mask;; i = (i + 1u) & mask) {
+				const entry * e = slots[i].load(std::memory_order_acquire);
+
+				if (e == nullptr) {
+					return nullptr;
+				}
+
+				if (e->hash == hash && e->raw == raw) {
+					return e;
+				}
+			}
+		}
+
+		void place(const entry & e) noexcept {
+			for (size_t i = e.hash & mask;; i = (i + 1u) & mask) {
+				if (slots[i].load(std::memory_order_relaxed) == nullptr) {
+					slots[i].store(&e, std::memory_order_release);
+					return;
+				}
+			}
+		}
+	};
+
+	struct alignas(64) shard {
+		std::atomic<const table *> current{nullptr};
+		mutable std::mutex mutex;
+		std::vector<std::unique_ptr<table>> tables; // old tables are kept alive as readers can still look into them
+		std::deque<entry> entries;
+	};
+
+	struct alignas(64) counters {
+		std::atomic<uint64_t> hits{0};
+		std::atomic<uint64_t> misses{0};
+	};
+
+	std::array<shard, shard_count> shards;
+	std::array<counters, stripe_count> stripes;
+
+	static size_t shard_of(uint64_t hash) noexcept {
+		return static_cast<size_t>(hash >> (64u - shard_bits));
+	}
+
+	// each thread counts into its own cache line
+	counters & local_counters() noexcept {
+		static std::atomic<size_t> next_stripe{0};
+		thread_local const size_t stripe = next_stripe.fetch_add(1u, std::memory_order_relaxed) % stripe_count;
+		return stripes[stripe];
+	}
+
+	const entry * find(uint64_t hash, std::string_view raw) noexcept {
+		const shard & s = shards[shard_of(hash)];
+		const entry * e = s.current.load(std::memory_order_acquire)->find(hash, raw);
+
+		counters & c = local_counters();
+		(e ? c.hits : c.misses).fetch_add(1u, std::memory_order_relaxed);
+
+		return e;
+	}
+
+	const entry & insert(uint64_t hash, std::string_view raw, std::string_view normalized) {
+		shard & s = shards[shard_of(hash)];
+		std::lock_guard lock{s.mutex};
+
+		const table * current = s.current.load(std::memory_order_relaxed);
+
+		// someone else was faster
+		if (const entry * e = current->find(hash, raw)) {
+			return *e;
+		}
+
+		const entry & e = s.entries.emplace_back(entry{hash, std::string(raw), std::string(normalized)});
+
+		// keep load factor at most 1/2
+		if (s.entries.size() * 2u > current->mask + 1u) {
+			auto bigger = std::make_unique<table>((current->mask + 1u) * 2u);
+
+			for (const entry & existing: s.entries) {
+				bigger->place(existing);
+			}
+
+			s.current.store(bigger.get(), std::memory_order_release);
+			s.tables.push_back(std::move(bigger));
+		} else {
+			// const_cast is fine here, we own all tables and only writer holding the lock modifies them
+			const_cast<table *>(current)->place(e);
+		}
+
+		return e;
+	}
+
+public:
+	struct statistics {
+		uint64_t hits;
+		uint64_t misses;
+
+		double hit_rate() const noexcept {
+			const uint64_t total = hits + misses;
+			return total ? static_cast<double>(hits) / static_cast<double>(total) : 0.0;
+		}
+	};
+
+	intern_cache() {
+		for (shard & s: shards) {
+			s.tables.push_back(std::make_unique<table>(initial_capacity));
+			s.current.store(s.tables.back().get(), std::memory_order_release);
+		}
+	}
+
+	intern_cache(const intern_cache &) = delete;
+	intern_cache & operator=(const intern_cache &) = delete;
+
+	// returns interned normalized string, on a miss the input is normalized in place (same as read_and_normalize_string)
+	// reader is left at the end quote in both cases
+	auto intern(string_reader & in) -> std::optional<std::string_view> {
+		auto probe = in;
+		const auto raw = read_raw_string(probe);
+
+		if (!raw) {
+			return std::nullopt;
+		}
+
+		const uint64_t hash = hash_string(*raw);
+
+		if (const entry * e = find(hash, *raw)) {
+			in = probe;
+			return e->normalized;
+		}
+
+		// normalization will overwrite the raw content
+		const auto raw_copy = std::string(*raw);
+		const auto normalized = read_and_normalize_string(in);
+		assert(normalized.has_value());
+
+		return insert(hash, raw_copy, *normalized).normalized;
+	}
+
+	// same as above but input is never modified
+	auto intern(std::string_view raw_json_string) -> std::optional<std::string_view> {
+		auto in = const_string_reader(raw_json_string);
+		const auto raw = read_raw_string(in);
+
+		if (!raw) {
+			return std::nullopt;
+		}
+
+		const uint64_t hash = hash_string(*raw);
+
+		if (const entry * e = find(hash, *raw)) {
+			return e->normalized;
+		}
+
+		// copy including both quotes
+		auto buffer = std::string(raw->data() - 1, raw->size() + 2u);
+		auto reader = string_reader(buffer);
+		const auto normalized = read_and_normalize_string(reader);
+		assert(normalized.has_value());
+
+		return insert(hash, *raw, *normalized).normalized;
+	}
+
+	size_t size() const {
+		size_t result = 0;
+
+		for (const shard & s: shards) {
+			std::lock_guard lock{s.mutex};
+			result += s.entries.size();
+		}
+
+		return result;
+	}
+
+	statistics stats() const noexcept {
+		statistics result{0, 0};
+
+		for (const counters & c: stripes) {
+			result.hits += c.hits.load(std::memory_order_relaxed);
+			result.misses += c.misses.load(std::memory_order_relaxed);
+		}
+
+		return result;
+	}
+
+	void reset_stats() noexcept {
+		for (counters & c: stripes) {
+			c.hits.store(0u, std::memory_order_relaxed);
+			c.misses.store(0u, std::memory_order_relaxed);
+		}
+	}
+};
+
+} // namespace json
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef LITERAL_HPP
+#define LITERAL_HPP
+
+#include "normalize.hpp"
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <array>
+#include <cstddef>
+
+namespace json {
+
+// string usable as a template argument, always zero terminated
+template <size_t N> struct fixed_string {
+	char content[N + 1u]{};
+
+	constexpr fixed_string() noexcept = default;
+
+	constexpr fixed_string(const char (&in)[N + 1u]) noexcept {
+		for (size_t i = 0; i != N; ++i) {
+			content[i] = in[i];
+		}
+	}
+
+	static constexpr size_t size() noexcept {
+		return N;
+	}
+
+	constexpr const char * data() const noexcept {
+		return content;
+	}
+
+	constexpr const char * c_str() const noexcept {
+		return content;
+	}
+
+	constexpr const char * begin() const noexcept {
+		return content;
+	}
+
+	constexpr const char * end() const noexcept {
+		return content + N;
+	}
+
+	constexpr std::string_view view() const noexcept {
+		return std::string_view(content, N);
+	}
+
+	constexpr operator std::string_view() const noexcept {
+		return view();
+	}
+
+	template <size_t M> constexpr bool operator==(const fixed_string<M> & rhs) const noexcept {
+		return view() == rhs.view();
+	}
+};
+
+template <size_t N> fixed_string(const char (&)[N]) -> fixed_string<N - 1u>;
+
+// escaped content (without quotes) is normalized into the buffer, which has place for both quotes
+template <size_t N> constexpr auto normalize_literal_into(const fixed_string<N> & input, std::array<char, N + 2u> & buffer) -> std::string_view {
+	buffer[0] = '"';
+	for (size_t i = 0; i != N; ++i) {
+		buffer[i + 1u] = input.content[i];
+	}
+	buffer[N + 1u] = '"';
+
+	auto reader = string_reader(std::span<char>(buffer));
+	const auto result = read_and_normalize_string(reader);
+
+	// everything must be consumed, otherwise there was an unescaped quote inside
+	if (!result || reader.remaining() != 1u) {
+		throw std::invalid_argument("unescaped quote in literal");
+	}
+
+	return *result;
+}
+
+template <fixed_string Input> consteval size_t normalized_literal_length() {
+	std::array<char, Input.size() + 2u> buffer{};
+	return normalize_literal_into(Input, buffer).size();
+}
+
+// normalize escaped json string at compile time into a string with exact length, invalid input is a compile error
+template <fixed_string Input> consteval auto normalize_literal() {
+	constexpr size_t length = normalized_literal_length<Input>();
+
+	std::array<char, Input.size() + 2u> buffer{};
+	const auto normalized = normalize_literal_into(Input, buffer);
+
+	fixed_string<length> output;
+	for (size_t i = 0; i != length; ++i) {
+		output.content[i] = normalized[i];
+	}
+
+	return output;
+}
+
+namespace literals {
+
+	template <fixed_string Input> consteval auto operator""_json_str() {
+		return normalize_literal<Input>();
+	}
+
+} // namespace literals
+
+} // namespace json
+
+#endif
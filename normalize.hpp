@@ -1,6 +1,7 @@
 #ifndef NORMALIZE_HPP
 #define NORMALIZE_HPP
 
+#include <bit>
 #include <iterator>
 #include <optional>
 #include <span>
@@ -9,17 +10,24 @@
 #include <string_view>
 #include <type_traits>
 #include <cassert>
+#include <concepts>
 #include <cstdint>
+#include <cstring>
 #include <array>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
 namespace json {
 
-struct string_reader {
-	char * current;
+template <typename CharT> struct basic_string_reader {
+	CharT * current;
 	const char * end;
 
-	explicit constexpr string_reader(std::span<char> in) noexcept: current{in.data()}, end{in.data() + in.size()} { }
-	explicit constexpr string_reader(std::string & in) noexcept: current{in.data()}, end{in.data() + in.size()} { }
+	explicit constexpr basic_string_reader(std::span<CharT> in) noexcept: current{in.data()}, end{in.data() + in.size()} { }
+	explicit constexpr basic_string_reader(std::string & in) noexcept requires(!std::is_const_v<CharT>): current{in.data()}, end{in.data() + in.size()} { }
+	explicit constexpr basic_string_reader(std::string_view in) noexcept requires(std::is_const_v<CharT>): current{in.data()}, end{in.data() + in.size()} { }
 
 	constexpr bool is_end() const noexcept {
 		return current >= end;
@@ -47,7 +55,7 @@ struct string_reader {
 		return static_cast<size_t>(std::distance(const_cast<const char *>(current), end));
 	}
 
-	constexpr auto writable_rest() const noexcept {
+	constexpr auto writable_rest() const noexcept requires(!std::is_const_v<CharT>) {
 		return std::span<char>(current, remaining());
 	}
 
@@ -69,6 +77,12 @@ struct string_reader {
 	}
 };
 
+// reader which normalizes in place
+using string_reader = basic_string_reader<char>;
+
+// reader which never writes into its input
+using const_string_reader = basic_string_reader<const char>;
+
 constexpr uint8_t additional_length_of(char8_t first_unit) noexcept {
 	return ((0x3A55000000000000ull >> ((unsigned(first_unit) >> 2u) & 0b111110u)) & 0b11u);
 }
@@ -151,6 +165,100 @@ constexpr bool invalid_value(int32_t v) noexcept {
 	return v < 0;
 }
 
+// helpers to look at 8 bytes at once (SWAR) without any platform specific intrinsics
+constexpr size_t word_size = sizeof(uint64_t);
+constexpr size_t short_string_size = 2u * word_size;
+
+constexpr uint64_t load_word(const char * ptr) noexcept {
+	if (std::is_constant_evaluated() || (std::endian::native != std::endian::little)) {
+		uint64_t result = 0;
+		for (unsigned i = 0; i != word_size; ++i) {
+			result |= static_cast<uint64_t>(static_cast<uint8_t>(ptr[i])) << (i * 8u);
+		}
+		return result;
+	}
+
+	uint64_t result;
+	std::memcpy(&result, ptr, word_size);
+	return result;
+}
+
+constexpr uint64_t broadcast(char c) noexcept {
+	return 0x01010101'01010101ull * static_cast<uint8_t>(c);
+}
+
+// highest bit is set in the first zero byte (and maybe in bytes after it)
+constexpr uint64_t zero_byte_mask(uint64_t v) noexcept {
+	return (v - 0x01010101'01010101ull) & ~v & 0x80808080'80808080ull;
+}
+
+constexpr uint64_t byte_mask_of(uint64_t v, char c) noexcept {
+	return zero_byte_mask(v ^ broadcast(c));
+}
+
+// end of string or an escape can't be handled by simple copy or compare
+constexpr bool has_quote_or_escape(uint64_t v) noexcept {
+	return (byte_mask_of(v, '"') | byte_mask_of(v, '\\')) != 0u;
+}
+
+constexpr void store_word(char * ptr, uint64_t v) noexcept {
+	if (std::is_constant_evaluated() || (std::endian::native != std::endian::little)) {
+		for (unsigned i = 0; i != word_size; ++i) {
+			ptr[i] = static_cast<char>(static_cast<uint8_t>(v >> (i * 8u)));
+		}
+		return;
+	}
+
+	std::memcpy(ptr, &v, word_size);
+}
+
+// streaming of large strings, these are runtime only
+constexpr size_t cache_line_size = 64u;
+constexpr size_t prefetch_distance = 16u * cache_line_size;
+constexpr size_t default_large_string_threshold = 1024u * 1024u;
+
+inline void prefetch_for_read(const char * ptr) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(ptr, 0, 0);
+#elif defined(_M_X64)
+	_mm_prefetch(ptr, _MM_HINT_NTA);
+#else
+	static_cast<void>(ptr);
+#endif
+}
+
+// store bypassing cache (if the platform can do it), pointer must be aligned to word
+inline void store_word_nontemporal(char * ptr, uint64_t v) noexcept {
+	assert((reinterpret_cast<uintptr_t>(ptr) % word_size) == 0u);
+#if defined(__x86_64__) || defined(_M_X64)
+	_mm_stream_si64(reinterpret_cast<long long *>(ptr), static_cast<long long>(v));
+#else
+	store_word(ptr, v);
+#endif
+}
+
+// make non-temporal stores visible before anything else
+inline void nontemporal_fence() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+	_mm_sfence();
+#endif
+}
+
+// bytes which stop simple copying (quote, escape or non-ascii), first set byte is always exact
+constexpr uint64_t stop_mask(uint64_t v) noexcept {
+	return byte_mask_of(v, '"') | byte_mask_of(v, '\\') | (v & 0x80808080'80808080ull);
+}
+
+// index of first byte with highest bit set in mask (word_size if there is none)
+constexpr unsigned first_byte_of(uint64_t mask) noexcept {
+	return static_cast<unsigned>(std::countr_zero(mask)) / 8u;
+}
+
+// keep only first n bytes of word (n <= word_size)
+constexpr uint64_t first_bytes_mask(unsigned n) noexcept {
+	return (n >= word_size) ? ~uint64_t{0} : ((uint64_t{1} << (n * 8u)) - 1u);
+}
+
 struct utf8_encode {
 	std::array<uint8_t, 4> mask;
 	std::array<uint8_t, 4> overlay;
@@ -222,6 +330,60 @@ constexpr void write_as_utf8_codepoint_with_branch(char *& writer, char32_t cp)
 	}
 }
 
+template <typename CharT> concept wide_code_unit = std::same_as<CharT, char16_t> || std::same_as<CharT, char32_t>;
+
+constexpr void write_codepoint(char16_t *& writer, char32_t cp) noexcept {
+	assert(is_valid_unicode_code_point(cp));
+
+	if (cp < 0x10000u) [[likely]] {
+		*writer++ = static_cast<char16_t>(cp);
+		return;
+	}
+
+	// split back into surrogate pair
+	constexpr char32_t lower_10_bits = 0b11111'11111ul;
+	cp -= 0x10000ul;
+	*writer++ = static_cast<char16_t>(0xD800u + (cp >> 10u));
+	*writer++ = static_cast<char16_t>(0xDC00u + (cp & lower_10_bits));
+}
+
+constexpr void write_codepoint(char32_t *& writer, char32_t cp) noexcept {
+	assert(is_valid_unicode_code_point(cp));
+	*writer++ = cp;
+}
+
+// decode one utf-8 code point and validate it (continuation bytes, shortest form, no surrogates, at most U+10FFFF)
+template <typename CharT> constexpr char32_t read_utf8_codepoint(basic_string_reader<CharT> & in, uint8_t number_of_additional_bytes) {
+	assert(number_of_additional_bytes <= 3u);
+	assert(in.has_at_least(number_of_additional_bytes + 1u));
+
+	constexpr auto first_unit_mask = std::array<uint8_t, 4>{0b0111'1111u, 0b0001'1111u, 0b0000'1111u, 0b0000'0111u};
+
+	const auto unit = [&](int i) {
+		return static_cast<char8_t>(in.peek(i));
+	};
+
+	// first code unit can't be continuation or longer than 4 bytes
+	bool error = ((unit(0) & 0b11'000000u) == 0b10'000000u) | (unit(0) >= 0b11111'000u);
+	char32_t cp = unit(0) & first_unit_mask[number_of_additional_bytes];
+
+	for (int i = 1; i <= number_of_additional_bytes; ++i) {
+		error |= (unit(i) & 0b11'000000u) != 0b10'000000u;
+		cp = (cp << 6u) | (unit(i) & 0b00'111111u);
+	}
+
+	// overlong forms, utf-16 surrogates and values over U+10FFFF can't be represented in utf-16 or utf-32
+	constexpr auto shortest_form_from = std::array<char32_t, 4>{0u, 0x80u, 0x800u, 0x10000u};
+	error |= (cp < shortest_form_from[number_of_additional_bytes]) | between(cp, 0xD800u, 0xDFFFu) | !is_valid_unicode_code_point(cp);
+
+	if (error) [[unlikely]] {
+		throw std::invalid_argument("invalid utf8");
+	}
+
+	in.move(number_of_additional_bytes + 1u);
+	return cp;
+}
+
 constexpr void copy_utf8_codepoint_to_output(char *& writer, string_reader & in, uint8_t number_of_additional_bytes) {
 	assert(number_of_additional_bytes >= 0u);
 	assert(number_of_additional_bytes <= 3u);
@@ -282,135 +444,645 @@ constexpr bool copy_utf8_codepoint_to_output_branch(char *& writer, string_reade
 	return error;
 }
 
-template <bool Branchless = false> [[gnu::flatten]] constexpr auto read_and_normalize_string(string_reader & in, std::span<char> output) -> std::optional<std::string_view> {
+// reads hexdec part of unicode escape (and following lo-surrogate escape if needed) into a code point
+// caller must check there are at least 5 characters available (4 + end quote)
+template <typename CharT> constexpr char32_t read_unicode_escape(basic_string_reader<CharT> & in) {
+	assert(in.has_at_least(5u));
+
+	// read 4 hexdec characters and convert into a number
+	const auto h = convert_to_value(in.peek(0), in.peek(1), in.peek(2), in.peek(3));
+	in.move(4);
+
+	if (invalid_value(h)) [[unlikely]] {
+		// invalid hexdec value
+		throw std::invalid_argument("invalid hexdec escape");
+	}
+
+	char32_t cp = static_cast<uint16_t>(h);
+
+	// if it's a surrogate pair, it's a special case, there is no other way how to encode values over 0xFFFFu
+	if (between(cp, 0xD800u, 0xDBFFu)) [[unlikely]] {
+		// and if there is not at least 6+1 characters (surrogate pair + end, we can fail)
+		if (!in.has_at_least(7u) || ((in.peek() != '\\') | (in.peek(1) != 'u'))) [[unlikely]] {
+			// something else than pair
+			throw std::invalid_argument("not following lo-surrogate");
+		}
+
+		// read 4 hexdec characters and convert into a number
+		const auto l = convert_to_value(in.peek(2), in.peek(3), in.peek(4), in.peek(5));
+		in.move(6);
+
+		const char32_t lo = static_cast<uint16_t>(l);
+
+		if (invalid_value(l)) [[unlikely]] {
+			// invalid hexdec value
+			throw std::invalid_argument("invalid hexdec in lo-surrogate");
+		}
+
+		if (!between(lo, 0xDC00u, 0xDFFFu)) [[unlikely]] {
+			throw std::invalid_argument("not lo-surrogate value");
+		}
+
+		constexpr char32_t lower_10_bits = 0b11111'11111ul;
+		cp = ((cp & lower_10_bits) << 10u) + (lo & lower_10_bits) + 0x10000ul;
+
+		// resulting character must be valid utf-32 code point
+		if (!is_valid_unicode_code_point(cp)) [[unlikely]] {
+			throw std::invalid_argument("invalid codepoint");
+		}
+	}
+
+	return cp;
+}
+
+// decodes json string escape (simple one-char escape or unicode escape) into a code point, reader must be at the backslash
+template <typename CharT> constexpr char32_t read_escape(basic_string_reader<CharT> & in) {
+	assert(!in.is_end() && in.peek() == '\\');
+	in.next();
+
+	if (in.is_end()) [[unlikely]] {
+		throw std::invalid_argument("unexpected end after escape");
+	}
+
+	const char c2 = in.peek();
+	in.next();
+
+	// use replacament table for simple one-char escapes
+	if (const char replacement = escape_table[static_cast<char8_t>(c2)]) [[likely]] {
+		return static_cast<char8_t>(replacement);
+	}
+
+	// there can be only unicode escape now and it must be at least 4 characters + 1 for end quote
+	if ((c2 != 'u') || !in.has_at_least(5u)) [[unlikely]] {
+		throw std::invalid_argument("not enough space");
+	}
+
+	return read_unicode_escape(in);
+}
+
+enum class case_folding {
+	none,
+	ascii, // A-Z only
+	latin, // ascii + simple case folding of Latin-1 Supplement and Latin Extended-A
+};
+
+// lowercase ascii bytes of word, non-ascii bytes are kept as they are
+template <case_folding Fold> constexpr uint64_t fold_ascii_word(uint64_t w) noexcept {
+	if constexpr (Fold == case_folding::none) {
+		return w;
+	} else {
+		constexpr uint64_t high_bits = 0x80808080'80808080ull;
+		const uint64_t heptets = w & ~high_bits;
+
+		// highest bit of each byte (no carry to next byte is possible)
+		const uint64_t at_least_A = heptets + broadcast(static_cast<char>(0x80u - 'A'));
+		const uint64_t above_Z = heptets + broadcast(static_cast<char>(0x80u - 'Z' - 1u));
+		const uint64_t upper = at_least_A & ~above_Z & ~w & high_bits;
+
+		// 0x80 >> 2 == 0x20 (difference between upper and lower case)
+		return w | (upper >> 2u);
+	}
+}
+
+template <case_folding Fold> constexpr char32_t fold_code_point(char32_t cp) noexcept {
+	if constexpr (Fold == case_folding::none) {
+		return cp;
+	} else {
+		if (between(cp, U'A', U'Z')) {
+			return cp + 0x20u;
+		}
+
+		if constexpr (Fold == case_folding::latin) {
+			if (cp < 0xB5u) [[likely]] {
+				return cp;
+			}
+
+			// MICRO SIGN => GREEK SMALL LETTER MU
+			if (cp == 0xB5u) {
+				return 0x3BCu;
+			}
+
+			// À-Þ (without ×)
+			if (between(cp, 0xC0u, 0xDEu)) {
+				return (cp != 0xD7u) ? (cp + 0x20u) : cp;
+			}
+
+			if (between(cp, 0x100u, 0x17Fu)) {
+				// İ has only full folding, ı ĸ ŉ are lowercase
+				if ((cp == 0x130u) | (cp == 0x131u) | (cp == 0x138u) | (cp == 0x149u)) {
+					return cp;
+				}
+
+				// Ÿ => ÿ
+				if (cp == 0x178u) {
+					return 0xFFu;
+				}
+
+				// LONG S => s
+				if (cp == 0x17Fu) {
+					return U's';
+				}
+
+				// pairs are aligned on odd code points in Ĺ-ň and Ź-ž, everywhere else on even
+				const bool odd_pairs = between(cp, 0x139u, 0x148u) || between(cp, 0x179u, 0x17Eu);
+				const bool is_upper = ((cp & 1u) == 1u) == odd_pairs;
+				return is_upper ? (cp + 1u) : cp;
+			}
+		}
+
+		return cp;
+	}
+}
+
+// fold code point which was just copied into output (it can only get shorter)
+template <case_folding Fold> constexpr void fold_written_code_point(char * first, char *& last) noexcept {
+	if constexpr (Fold != case_folding::none) {
+		const auto length = std::distance(first, last);
+
+		if (length == 1) [[likely]] {
+			*first = static_cast<char>(fold_code_point<case_folding::ascii>(static_cast<char8_t>(*first)));
+			return;
+		}
+
+		if constexpr (Fold == case_folding::latin) {
+			// only U+0080-U+017F can change
+			if (length == 2 && between(static_cast<char8_t>(*first), 0xC2u, 0xC5u)) {
+				const char32_t cp = (char32_t{static_cast<char8_t>(first[0])} & 0b0001'1111u) << 6u | (char32_t{static_cast<char8_t>(first[1])} & 0b0011'1111u);
+
+				if (const char32_t folded = fold_code_point<Fold>(cp); folded != cp) {
+					last = first;
+					write_as_utf8_codepoint_with_branch(last, folded);
+				}
+			}
+		}
+	}
+}
+
+// observer is called with every written code point or run of them (first, last), so a caller can look at the output while it's still hot
+struct no_observer {
+	constexpr void operator()(const char *, const char *) const noexcept { }
+};
+
+// normalize one code point or escape, returns false when end quote is reached (it's not consumed)
+template <bool Branchless, case_folding Fold, typename Observer> [[gnu::always_inline]] constexpr bool normalize_code_point(string_reader & in, char *& writer, Observer & observer) {
+	if (in.is_end()) [[unlikely]] {
+		throw std::invalid_argument("unexpected end");
+	}
+
+	const char c = in.peek();
+
+	// end of string
+	if (in.peek() == '"') [[unlikely]] {
+		return false;
+	}
+
+	// json string escape
+	if (in.peek() == '\\') [[unlikely]] {
+		const char32_t cp = fold_code_point<Fold>(read_escape(in));
+		const char * const written_from = writer;
+
+		// it's given
+		if constexpr (Branchless) {
+			write_as_utf8_codepoint(writer, cp);
+		} else {
+			write_as_utf8_codepoint_with_branch(writer, cp);
+		}
+
+		observer(written_from, writer);
+		return true;
+	}
+
+	// handle normal utf-8 unicode (copy each code-point and validate)
+
+	const uint8_t number_of_additional_bytes = additional_length_of(static_cast<char8_t>(c));
+
+	// number of bytes of code_point + current + end quote, otherwise we can end
+	if (!in.has_at_least(number_of_additional_bytes + 2u)) [[unlikely]] {
+		throw std::invalid_argument("not enough space");
+	}
+
+	char * const written_from = writer;
+
+	if constexpr (Branchless) {
+		copy_utf8_codepoint_to_output(writer, in, number_of_additional_bytes);
+	} else {
+		if (copy_utf8_codepoint_to_output_branch(writer, in, number_of_additional_bytes)) {
+			throw std::invalid_argument("invalid utf8");
+		}
+	}
+
+	fold_written_code_point<Fold>(written_from, writer);
+	observer(written_from, writer);
+	return true;
+}
+
+// ascii run is copied as a whole word (+1 for end quote), otherwise one code point is normalized, returns false at end quote
+template <bool Branchless, case_folding Fold, typename Observer> [[gnu::always_inline]] constexpr bool normalize_word_or_code_point(string_reader & in, char *& writer, Observer & observer) {
+	if (in.has_at_least(word_size + 1u)) [[likely]] {
+		const uint64_t w = load_word(in.current);
+
+		if (stop_mask(w) == 0u) {
+			// in place output is behind reader, so the word is already loaded
+			store_word(writer, fold_ascii_word<Fold>(w));
+			observer(writer, writer + word_size);
+			writer += word_size;
+			in.move(word_size);
+			return true;
+		}
+	}
+
+	return normalize_code_point<Branchless, Fold>(in, writer, observer);
+}
+
+// keep prefetching ahead of reader (once per cache line)
+struct read_ahead {
+	const char * prefetched;
+
+	void operator()(const char * current) noexcept {
+		if (current >= prefetched) {
+			prefetch_for_read(prefetched + prefetch_distance);
+			prefetched += cache_line_size;
+		}
+	}
+};
+
+// rest of a large string normalized in place (or with observer), input is prefetched ahead
+template <bool Branchless, case_folding Fold, typename Observer> [[gnu::flatten, gnu::noinline]] char * normalize_streaming(string_reader & in, char * writer, Observer & observer) {
+	auto prefetch = read_ahead{in.current};
+
+	for (;;) {
+		prefetch(in.current);
+
+		if (!normalize_word_or_code_point<Branchless, Fold>(in, writer, observer)) {
+			return writer;
+		}
+	}
+}
+
+// rest of a large string normalized into separate output, it's staged in small cache-resident buffer
+// and only whole cache lines are written with non-temporal stores, so the output doesn't evict everything else from cache
+template <bool Branchless, case_folding Fold> [[gnu::flatten, gnu::noinline]] char * normalize_streaming_nontemporal(string_reader & in, char * writer) {
+	constexpr size_t staging_size = 4096u;
+	alignas(cache_line_size) char staging[staging_size + cache_line_size];
+
+	// staging buffer is mapped on cache lines of output, first line can be shared with previous content
+	char * line = reinterpret_cast<char *>(reinterpret_cast<uintptr_t>(writer) & ~uintptr_t{cache_line_size - 1u});
+	size_t skip = static_cast<size_t>(std::distance(line, writer));
+	char * staged = staging + skip;
+
+	const auto flush = [&](size_t lines) {
+		for (size_t l = 0; l != lines; ++l) {
+			const char * from = staging + l * cache_line_size;
+
+			if (skip != 0u) {
+				// first (shared) line is written normally
+				std::memcpy(line + skip, from + skip, cache_line_size - skip);
+				skip = 0u;
+			} else {
+				for (size_t i = 0; i != cache_line_size; i += word_size) {
+					store_word_nontemporal(line + i, load_word(from + i));
+				}
+			}
+
+			line += cache_line_size;
+		}
+
+		// move rest of unfinished line to the front
+		const size_t flushed = lines * cache_line_size;
+		const size_t rest = static_cast<size_t>(std::distance(staging + flushed, staged));
+		std::memmove(staging, staging + flushed, rest);
+		staged = staging + rest;
+	};
+
+	auto prefetch = read_ahead{in.current};
+	auto observer = no_observer{};
+
+	for (;;) {
+		prefetch(in.current);
+
+		if (!normalize_word_or_code_point<Branchless, Fold>(in, staged, observer)) {
+			break;
+		}
+
+		if (staged >= (staging + staging_size)) [[unlikely]] {
+			flush(staging_size / cache_line_size);
+		}
+	}
+
+	// whole lines are streamed and rest is copied
+	flush(static_cast<size_t>(std::distance(staging, staged)) / cache_line_size);
+	nontemporal_fence();
+
+	const size_t rest = static_cast<size_t>(std::distance(staging, staged));
+	std::memcpy(line + skip, staging + skip, rest - skip);
+
+	return line + rest;
+}
+
+// output doesn't share any byte with rest of the input (it's not normalization in place), runtime only
+inline bool is_disjoint(std::span<const char> output, const string_reader & in) noexcept {
+	return (output.data() + output.size() <= in.current) || (output.data() >= in.end);
+}
+
+// kept out of line (even from flattened callers), so short strings don't pay for the staging buffer on their stack
+template <bool Branchless, case_folding Fold, typename Observer> [[gnu::noinline, gnu::cold]] char * normalize_large_string_rest(string_reader & in, char * writer, std::span<char> output, Observer & observer) {
+	// non-temporal stores of in-place output would evict lines reader is still reading and observer would read them back right away
+	const bool disjoint = is_disjoint(output, in);
+	constexpr bool observed = !std::is_same_v<std::remove_cvref_t<Observer>, no_observer>;
+
+	if (disjoint && !observed) {
+		return normalize_streaming_nontemporal<Branchless, Fold>(in, writer);
+	} else {
+		return normalize_streaming<Branchless, Fold>(in, writer, observer);
+	}
+}
+
+// strings longer than large_string_threshold are streamed after that point (see normalize_large_string_rest)
+template <bool Branchless = false, case_folding Fold = case_folding::none, typename Observer = no_observer> [[gnu::flatten]] constexpr auto read_and_normalize_string(string_reader & in, std::span<char> output, Observer && observer = {}, size_t large_string_threshold = default_large_string_threshold) -> std::optional<std::string_view> {
 	if (!in.read_character('"')) {
 		return std::nullopt;
 	}
 
 	char * writer = output.data();
 
+	// short strings (most of keys) are handled with one load, whole string is copied if the end quote is found before any escape or non-ascii
+	// otherwise the copied prefix is skipped and rest is left to the loop below (which also does everything during constant evaluation)
+	if (!std::is_constant_evaluated() && in.has_at_least(short_string_size) && output.size() >= short_string_size) [[likely]] {
+		const uint64_t lo = fold_ascii_word<Fold>(load_word(in.current));
+		const uint64_t hi = fold_ascii_word<Fold>(load_word(in.current + word_size));
+
+		const uint64_t lo_stop = stop_mask(lo);
+		const unsigned length = lo_stop ? first_byte_of(lo_stop) : (word_size + first_byte_of(stop_mask(hi)));
+
+		if (is_disjoint(output, in)) [[likely]] {
+			// bytes after the string are just unused part of output
+			store_word(writer, lo);
+			store_word(writer + word_size, hi);
+		} else {
+			// in-place output overlaps the input, so everything is loaded before storing and bytes after the string are kept
+			const uint64_t lo_keep = first_bytes_mask(length);
+			const uint64_t hi_keep = (length > word_size) ? first_bytes_mask(length - word_size) : 0u;
+
+			const uint64_t old_lo = load_word(writer);
+			const uint64_t old_hi = load_word(writer + word_size);
+
+			store_word(writer, (lo & lo_keep) | (old_lo & ~lo_keep));
+			store_word(writer + word_size, (hi & hi_keep) | (old_hi & ~hi_keep));
+		}
+
+		observer(writer, writer + length);
+		writer += length;
+		in.move(static_cast<int>(length));
+
+		if (length < short_string_size && in.peek() == '"') [[likely]] {
+			return std::string_view(output.data(), length);
+		}
+	}
+
+	// strings over the threshold are streamed from there (but not during constant evaluation)
+	// shorter strings never get there, so unexpected end is reported by the loop itself
+	const char * const large_from = (!std::is_constant_evaluated() && in.remaining() > large_string_threshold) ? in.current + large_string_threshold : nullptr;
+
 	// we loop thru
 	for (;;) {
+		if (large_from != nullptr && in.current >= large_from) [[unlikely]] {
+			writer = normalize_large_string_rest<Branchless, Fold>(in, writer, output, observer);
+			break;
+		}
+
+		if (!normalize_word_or_code_point<Branchless, Fold>(in, writer, observer)) {
+			break;
+		}
+	}
+
+	// return writed part as it's now normalized
+	return std::string_view(output.data(), static_cast<size_t>(std::distance(output.data(), writer)));
+}
+
+template <bool Branchless = false> [[gnu::flatten]] constexpr auto read_and_normalize_string(string_reader & in) -> std::optional<std::string_view> {
+	return read_and_normalize_string<Branchless>(in, in.writable_rest());
+}
+
+// normalize and case fold in the same pass (for case-insensitive keys)
+template <case_folding Fold, bool Branchless = false> [[gnu::flatten]] constexpr auto read_and_normalize_folded_string(string_reader & in, std::span<char> output) -> std::optional<std::string_view> {
+	return read_and_normalize_string<Branchless, Fold>(in, output);
+}
+
+template <case_folding Fold, bool Branchless = false> [[gnu::flatten]] constexpr auto read_and_normalize_folded_string(string_reader & in) -> std::optional<std::string_view> {
+	return read_and_normalize_folded_string<Fold, Branchless>(in, in.writable_rest());
+}
+
+// normalize directly into utf-16 or utf-32, output must have at least as many code units as the input has bytes
+// raw utf-8 is decoded with full validation, so overlong forms, encoded surrogates and values over U+10FFFF are rejected
+// (utf-8 output only checks continuation bytes and copies them as they are)
+template <wide_code_unit CharT, typename ReaderCharT> [[gnu::flatten]] constexpr auto read_and_normalize_string(basic_string_reader<ReaderCharT> & in, std::span<CharT> output) -> std::optional<std::basic_string_view<CharT>> {
+	if (!in.read_character('"')) {
+		return std::nullopt;
+	}
+
+	CharT * writer = output.data();
+
+	for (;;) {
+		// widen ascii runs word by word (+1 for end quote)
+		while (in.has_at_least(word_size + 1u)) {
+			const uint64_t w = load_word(in.current);
+
+			if (has_quote_or_escape(w) || (w & 0x80808080'80808080ull) != 0u) {
+				break;
+			}
+
+			assert((writer + word_size) <= (output.data() + output.size()));
+
+			for (unsigned i = 0; i != word_size; ++i) {
+				writer[i] = static_cast<CharT>(static_cast<char8_t>(in.peek(static_cast<int>(i))));
+			}
+
+			writer += word_size;
+			in.move(word_size);
+		}
+
 		if (in.is_end()) [[unlikely]] {
 			throw std::invalid_argument("unexpected end");
-			return std::nullopt;
 		}
 
 		const char c = in.peek();
 
 		// end of string
-		if (in.peek() == '"') [[unlikely]] {
+		if (c == '"') [[unlikely]] {
 			break;
 		}
 
+		assert(writer < (output.data() + output.size()));
+
 		// json string escape
-		if (in.peek() == '\\') [[unlikely]] {
-			in.next();
-			if (in.is_end()) [[unlikely]] {
-				throw std::invalid_argument("unexpected end after escape");
-				return std::nullopt;
-			}
+		if (c == '\\') [[unlikely]] {
+			write_codepoint(writer, read_escape(in));
+			continue;
+		}
 
-			const char c2 = in.peek();
-			in.next();
+		// handle normal utf-8 unicode (decode each code-point and validate)
+		const uint8_t number_of_additional_bytes = additional_length_of(static_cast<char8_t>(c));
 
-			// use replacament table for simple one-char escapes
-			if (const char replacement = escape_table[static_cast<char8_t>(c2)]) [[likely]] {
-				assert(writer < (output.data() + output.size()));
-				*writer++ = replacement;
-				continue;
-			}
+		// number of bytes of code_point + current + end quote, otherwise we can end
+		if (!in.has_at_least(number_of_additional_bytes + 2u)) [[unlikely]] {
+			throw std::invalid_argument("not enough space");
+		}
+
+		write_codepoint(writer, read_utf8_codepoint(in, number_of_additional_bytes));
+	}
+
+	return std::basic_string_view<CharT>(output.data(), static_cast<size_t>(std::distance(output.data(), writer)));
+}
+
+// finds end quote of string which content starts at current (escapes are skipped, not validated)
+// returns nullptr if it's not there (yet)
+constexpr const char * find_end_quote(const char * current, const char * end) noexcept {
+	for (;;) {
+		// skip everything without quote or escape word by word
+		while (static_cast<size_t>(std::distance(current, end)) >= word_size && !has_quote_or_escape(load_word(current))) {
+			current += word_size;
+		}
+
+		if (current == end) {
+			return nullptr;
+		}
 
-			// there can be only unicode escape now and it must be at least 4 characters + 1 for end quote
-			if ((c2 != 'u') || !in.has_at_least(5u)) [[unlikely]] {
-				throw std::invalid_argument("not enough space");
-				return std::nullopt;
+		if (*current == '"') {
+			return current;
+		}
+
+		if (*current == '\\') {
+			++current;
+			if (current == end) {
+				return nullptr;
 			}
+		}
+
+		++current;
+	}
+}
+
+// finds raw (still escaped) content of a string without decoding it, escapes are skipped but not validated
+// reader is left at the end quote same as with read_and_normalize_string
+template <typename CharT> constexpr auto read_raw_string(basic_string_reader<CharT> & in) -> std::optional<std::string_view> {
+	if (!in.read_character('"')) {
+		return std::nullopt;
+	}
+
+	const char * const begin = in.current;
+	const char * const quote = find_end_quote(begin, in.end);
+
+	if (quote == nullptr) [[unlikely]] {
+		throw std::invalid_argument("unexpected end");
+	}
+
+	const auto length = static_cast<size_t>(std::distance(begin, quote));
+	in.current += length;
+
+	return std::string_view(begin, length);
+}
+
+// compares escaped json string with already normalized utf-8 target without writing anything
+// it stops at first difference, so rest of the input is not validated in such case
+constexpr bool equals_escaped(std::string_view raw_json_string, std::string_view target) {
+	auto in = const_string_reader(raw_json_string);
+
+	if (!in.read_character('"')) {
+		return false;
+	}
+
+	const char * expected = target.data();
+	const char * const expected_end = target.data() + target.size();
+
+	const auto expected_remaining = [&] {
+		return static_cast<size_t>(std::distance(expected, expected_end));
+	};
+
+	for (;;) {
+		// compare escape-free ascii prefix word by word
+		while (in.has_at_least(word_size) && expected_remaining() >= word_size) {
+			const uint64_t w = load_word(in.current);
 
-			// read 4 hexdec characters and convert into a number
-			const auto h = convert_to_value(in.peek(0), in.peek(1), in.peek(2), in.peek(3));
-			in.move(4);
+			if (stop_mask(w) != 0u) {
+				break;
+			}
 
-			if (invalid_value(h)) [[unlikely]] {
-				// invalid hexdec value
-				throw std::invalid_argument("invalid hexdec escape");
-				return std::nullopt;
+			if (w != load_word(expected)) {
+				return false;
 			}
 
-			char32_t cp = static_cast<uint16_t>(h);
+			in.move(word_size);
+			expected += word_size;
+		}
 
-			// if it's a surrogate pair, it's a special case, there is no other way how to encode values over 0xFFFFu
-			if (between(cp, 0xD800u, 0xDBFFu)) [[unlikely]] {
-				// and if there is not at least 6+1 characters (surrogate pair + end, we can fail)
-				if (!in.has_at_least(7u) || ((in.peek() != '\\') | (in.peek(1) != 'u'))) [[unlikely]] {
-					// something else than pair
-					throw std::invalid_argument("not following lo-surrogate");
-					return std::nullopt;
-				}
+		if (in.is_end()) [[unlikely]] {
+			throw std::invalid_argument("unexpected end");
+		}
 
-				// read 4 hexdec characters and convert into a number
-				const auto l = convert_to_value(in.peek(2), in.peek(3), in.peek(4), in.peek(5));
-				in.move(6);
+		const char c = in.peek();
 
-				const char32_t lo = static_cast<uint16_t>(l);
+		// end of string
+		if (c == '"') {
+			return expected == expected_end;
+		}
 
-				if (invalid_value(l)) [[unlikely]] {
-					// invalid hexdec value
-					throw std::invalid_argument("invalid hexdec in lo-surrogate");
-					return std::nullopt;
-				}
+		// json string escape
+		if (c == '\\') {
+			const char32_t cp = read_escape(in);
 
-				if (!between(lo, 0xDC00u, 0xDFFFu)) [[unlikely]] {
-					throw std::invalid_argument("not lo-surrogate value");
-					return std::nullopt;
-				}
+			// encode into small local buffer and compare it with target
+			std::array<char, 4> buffer{};
+			char * writer = buffer.data();
+			write_as_utf8_codepoint_with_branch(writer, cp);
 
-				constexpr char32_t lower_10_bits = 0b11111'11111ul;
-				cp = ((cp & lower_10_bits) << 10u) + (lo & lower_10_bits) + 0x10000ul;
+			const auto length = static_cast<size_t>(std::distance(buffer.data(), writer));
 
-				// resulting character must be valid utf-32 code point
-				if (!is_valid_unicode_code_point(cp)) [[unlikely]] {
-					throw std::invalid_argument("invalid codepoint");
-					return std::nullopt;
-				}
+			if (expected_remaining() < length) {
+				return false;
 			}
 
-			// it's given
-			if constexpr (Branchless) {
-				write_as_utf8_codepoint(writer, cp);
-			} else {
-				write_as_utf8_codepoint_with_branch(writer, cp);
+			for (size_t i = 0; i != length; ++i) {
+				if (expected[i] != buffer[i]) {
+					return false;
+				}
 			}
 
+			expected += length;
 			continue;
 		}
 
-		// handle normal utf-8 unicode (copy each code-point and validate)
-
+		// utf-8 code point is validated same as when it's copied (number of bytes + end quote, continuation bytes)
 		const uint8_t number_of_additional_bytes = additional_length_of(static_cast<char8_t>(c));
 
-		// number of bytes of code_point + current + end quote, otherwise we can end
 		if (!in.has_at_least(number_of_additional_bytes + 2u)) [[unlikely]] {
 			throw std::invalid_argument("not enough space");
-			return std::nullopt;
 		}
 
-		if constexpr (Branchless) {
-			copy_utf8_codepoint_to_output(writer, in, number_of_additional_bytes);
-		} else {
-			if (copy_utf8_codepoint_to_output_branch(writer, in, number_of_additional_bytes)) {
-				throw std::invalid_argument("invalid utf8");
-				return std::nullopt;
-			}
+		bool error = (static_cast<char8_t>(c) & 0b11'000000u) == 0b10'000000u;
+		for (int i = 1; i <= number_of_additional_bytes; ++i) {
+			error |= (static_cast<char8_t>(in.peek(i)) & 0b11'000000u) != 0b10'000000u;
 		}
-	}
 
-	// return writed part as it's now normalized
-	return std::string_view(output.data(), static_cast<size_t>(std::distance(output.data(), writer)));
-}
+		if (error) [[unlikely]] {
+			throw std::invalid_argument("invalid utf8");
+		}
 
-template <bool Branchless = false> [[gnu::flatten]] constexpr auto read_and_normalize_string(string_reader & in) -> std::optional<std::string_view> {
-	return read_and_normalize_string<Branchless>(in, in.writable_rest());
+		// and then it must be exactly same as in target
+		const size_t length = number_of_additional_bytes + 1u;
+
+		if (expected_remaining() < length) {
+			return false;
+		}
+
+		for (size_t i = 0; i != length; ++i) {
+			if (expected[i] != in.peek(static_cast<int>(i))) {
+				return false;
+			}
+		}
+
+		in.move(static_cast<int>(length));
+		expected += length;
+	}
 }
 
 } // namespace json
@@ -1,12 +1,28 @@
+#include "code_points.hpp"
 #include "generate.hpp"
+#include "hash.hpp"
+#include "intern.hpp"
+#include "literal.hpp"
 #include "normalize.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iterator>
 #include <random>
 #include <sstream>
+#include <thread>
 #include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <iostream>
 
+#ifdef __linux__
+#include "ingest.hpp"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 std::string repeat(std::string_view input, int n) {
 	std::ostringstream os;
 	os << "\"";
@@ -17,6 +33,73 @@ std::string repeat(std::string_view input, int n) {
 	return std::move(os).str();
 }
 
+// counts last level cache misses of current thread (if the kernel lets us)
+class llc_miss_counter {
+	int fd{-1};
+
+public:
+	llc_miss_counter() {
+#ifdef __linux__
+		perf_event_attr attr{};
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+	}
+
+	llc_miss_counter(const llc_miss_counter &) = delete;
+
+	~llc_miss_counter() {
+#ifdef __linux__
+		if (fd != -1) {
+			close(fd);
+		}
+#endif
+	}
+
+	void start() noexcept {
+#ifdef __linux__
+		if (fd != -1) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	std::optional<uint64_t> stop() noexcept {
+#ifdef __linux__
+		uint64_t count = 0;
+		if (fd != -1 && ioctl(fd, PERF_EVENT_IOC_DISABLE, 0) == 0 && read(fd, &count, sizeof(count)) == sizeof(count)) {
+			return count;
+		}
+#endif
+		return std::nullopt;
+	}
+};
+
+// single run with throughput and cache misses, as catch's benchmark reports only time
+template <typename Fn> void report_throughput(std::string_view name, size_t bytes, Fn && fn) {
+	llc_miss_counter counter;
+
+	const auto start = std::chrono::steady_clock::now();
+	counter.start();
+	fn();
+	const auto misses = counter.stop();
+	const auto end = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(end - start).count();
+	std::cout << name << ": " << (static_cast<double>(bytes) / seconds / (1024.0 * 1024.0)) << " MB/s, LLC misses: ";
+	if (misses) {
+		std::cout << *misses << "\n";
+	} else {
+		std::cout << "n/a\n";
+	}
+}
+
 std::optional<std::string_view> normalize(std::string & content) {
 	auto reader = json::string_reader(content);
 	const auto view = json::read_and_normalize_string(reader);
@@ -57,6 +140,870 @@ TEST_CASE("unicode length") {
 	}
 }
 
+TEST_CASE("equals escaped") {
+	static_assert(json::equals_escaped(R"("hello")"sv, "hello"sv));
+	static_assert(!json::equals_escaped(R"("hello")"sv, "hellO"sv));
+
+	REQUIRE(json::equals_escaped(R"("")"sv, ""sv));
+	REQUIRE(json::equals_escaped(R"("a longer key without any escapes")"sv, "a longer key without any escapes"sv));
+	REQUIRE(json::equals_escaped(R"("tab\there \"quoted\" \\ \/")"sv, "tab\there \"quoted\" \\ /"sv));
+	REQUIRE(json::equals_escaped(R"("Mil\u00E1nek \uD83D\uDC76 & ěščřž")"sv, "Milánek 👶 & ěščřž"sv));
+
+	// mismatches
+	REQUIRE_FALSE(json::equals_escaped(R"("a longer key without any escapes")"sv, "a longer key without any escape"sv));
+	REQUIRE_FALSE(json::equals_escaped(R"("a longer key without any escape")"sv, "a longer key without any escapes"sv));
+	REQUIRE_FALSE(json::equals_escaped(R"("Mil\u00E1nek")"sv, "Milanek"sv));
+	REQUIRE_FALSE(json::equals_escaped(R"("\u00E1")"sv, "\xC3"sv));
+	REQUIRE_FALSE(json::equals_escaped(R"("\n")"sv, "\r"sv));
+	REQUIRE_FALSE(json::equals_escaped("hello"sv, "hello"sv));
+
+	// early exit means invalid input after first difference is not detected
+	REQUIRE_FALSE(json::equals_escaped(R"("abc\x")"sv, "abd"sv));
+	REQUIRE_THROWS_AS(json::equals_escaped(R"("abc\x")"sv, "abc"sv), std::invalid_argument);
+	REQUIRE_THROWS_AS(json::equals_escaped(R"("abc)"sv, "abc"sv), std::invalid_argument);
+
+	// invalid utf-8 is rejected same as by normalization, even when target has the same bytes
+	REQUIRE_THROWS_AS(json::equals_escaped("\"\x80\""sv, "\x80"sv), std::invalid_argument);
+	REQUIRE_THROWS_AS(json::equals_escaped("\"\xC3\x28\""sv, "\xC3\x28"sv), std::invalid_argument);
+	REQUIRE_THROWS_AS(json::equals_escaped("\"\xC3\""sv, "\xC3"sv), std::invalid_argument);
+	REQUIRE_THROWS_AS(json::equals_escaped("\"abcdefgh\x80\x80\x80\x80\x80\x80\x80\x80\""sv, "abcdefgh\x80\x80\x80\x80\x80\x80\x80\x80"sv), std::invalid_argument);
+	{
+		std::string invalid = "\"\x80\"";
+		REQUIRE_THROWS_AS(normalize(invalid), std::invalid_argument);
+	}
+
+	// must give same result as normalize and compare
+	for (int i = 0; i != 100; ++i) {
+		const auto raw = generate_random_json_string_with_length(200);
+		auto copy = raw;
+		const auto normalized = std::string{*normalize(copy)};
+
+		REQUIRE(json::equals_escaped(raw, normalized));
+		REQUIRE_FALSE(json::equals_escaped(raw, normalized + "x"));
+		REQUIRE_FALSE(json::equals_escaped(raw, normalized.substr(0, normalized.size() / 2u)));
+	}
+
+	constexpr auto key = R"("some\/longer\/key\u0020name")"sv;
+	constexpr auto target = "some/longer/key name"sv;
+
+	BENCHMARK_ADVANCED("key lookup (normalize + compare)")
+	(Catch::Benchmark::Chronometer meter) {
+		std::vector<std::string> v(meter.runs());
+		std::fill(v.begin(), v.end(), std::string{key});
+
+		meter.measure([&](int i) {
+			const auto out = normalize(v[i]);
+			REQUIRE(out.has_value());
+			return *out == target;
+		});
+	};
+
+	BENCHMARK_ADVANCED("key lookup (equals escaped)")
+	(Catch::Benchmark::Chronometer meter) {
+		meter.measure([&] {
+			return json::equals_escaped(key, target);
+		});
+	};
+}
+
+TEST_CASE("hash") {
+	static_assert(json::hash_string("hello") != json::hash_string("hellO"));
+	static_assert(json::hash_string("") != json::hash_string(std::string_view("\0", 1)));
+
+	// hash doesn't depend on how the input was split
+	constexpr auto in = "some key which is longer than a word"sv;
+	for (size_t split = 0; split <= in.size(); ++split) {
+		auto hasher = json::string_hasher{};
+		hasher.update(in.data(), in.data() + split);
+		for (size_t i = split; i != in.size(); ++i) {
+			hasher.update(in[i]);
+		}
+		REQUIRE(hasher.finalize() == json::hash_string(in));
+	}
+
+	// fused hash is same as hashing of normalized output
+	for (int i = 0; i != 100; ++i) {
+		auto a = generate_random_json_string_with_length(200);
+		auto b = a;
+
+		auto reader = json::string_reader(a);
+		const auto hashed = json::read_and_normalize_string_with_hash(reader);
+		REQUIRE(hashed.has_value());
+
+		const auto normalized = normalize(b);
+		REQUIRE(normalized.has_value());
+		REQUIRE(hashed->view == *normalized);
+		REQUIRE(hashed->hash == json::hash_string(*normalized));
+	}
+
+	std::string str = R"("na\u006De")";
+	auto reader = json::string_reader(str);
+	const auto hashed = json::read_and_normalize_string_with_hash(reader);
+	REQUIRE(hashed.has_value());
+	REQUIRE(hashed->view == "name");
+	REQUIRE(hashed->hash == json::hash_string("name"));
+
+	BENCHMARK_ADVANCED("normalize + hash")
+	(Catch::Benchmark::Chronometer meter) {
+		std::vector<std::string> v(meter.runs());
+		std::fill(v.begin(), v.end(), generate_random_json_string_with_length(100 * 1024));
+
+		meter.measure([&](int i) {
+			const auto out = normalize(v[i]);
+			REQUIRE(out.has_value());
+			return json::hash_string(*out);
+		});
+	};
+
+	BENCHMARK_ADVANCED("normalize with hash")
+	(Catch::Benchmark::Chronometer meter) {
+		std::vector<std::string> v(meter.runs());
+		std::fill(v.begin(), v.end(), generate_random_json_string_with_length(100 * 1024));
+
+		meter.measure([&](int i) {
+			auto reader = json::string_reader(v[i]);
+			const auto out = json::read_and_normalize_string_with_hash(reader);
+			REQUIRE(out.has_value());
+			return out->hash;
+		});
+	};
+}
+
+TEST_CASE("key set") {
+	static constexpr auto keys = json::make_key_set("id", "name", "value", "type", "children", "parent", "created_at", "updated_at", "tags", "size");
+
+	static_assert(keys.size() == 10u);
+	static_assert(keys.find("id") == 0u);
+	static_assert(keys.find("size") == 9u);
+	static_assert(!keys.find("Id").has_value());
+
+	for (size_t i = 0; i != keys.size(); ++i) {
+		REQUIRE(keys.find(keys[i]) == i);
+	}
+
+	REQUIRE_FALSE(keys.find("").has_value());
+	REQUIRE_FALSE(keys.find("identifier").has_value());
+
+	constexpr auto empty = json::make_key_set();
+	REQUIRE_FALSE(empty.find("id").has_value());
+
+	std::string str = R"("cr\u0065ated_at")";
+	auto reader = json::string_reader(str);
+	const auto key = json::read_and_normalize_string_with_hash(reader);
+	REQUIRE(key.has_value());
+	REQUIRE(keys.find(*key) == 6u);
+
+	BENCHMARK("field dispatch (key set)") {
+		return keys.find("updated_at", json::hash_string("updated_at"));
+	};
+}
+
+// pick keys with zipf-like distribution (few keys are very common)
+std::vector<std::string_view> sample_keys(const std::vector<std::string> & keys, size_t count) {
+	std::vector<double> weights(keys.size());
+	for (size_t i = 0; i != weights.size(); ++i) {
+		weights[i] = 1.0 / static_cast<double>(i + 1u);
+	}
+
+	std::mt19937 gen(42);
+	std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+
+	std::vector<std::string_view> output(count);
+	std::generate(output.begin(), output.end(), [&] { return std::string_view(keys[pick(gen)]); });
+	return output;
+}
+
+template <typename Fn> void run_in_threads(unsigned threads, Fn && fn) {
+	std::vector<std::jthread> workers;
+	for (unsigned t = 0; t != threads; ++t) {
+		workers.emplace_back([&fn, t] { fn(t); });
+	}
+}
+
+TEST_CASE("intern cache") {
+	auto cache = json::intern_cache{};
+
+	std::string a = R"("caf\u00e9")";
+	std::string b = R"("caf\u00e9")";
+
+	auto reader_a = json::string_reader(a);
+	const auto first = cache.intern(reader_a);
+	REQUIRE(first.has_value());
+	REQUIRE(*first == "café");
+	REQUIRE(reader_a.peek() == '"');
+
+	auto reader_b = json::string_reader(b);
+	const auto second = cache.intern(reader_b);
+	REQUIRE(second.has_value());
+	REQUIRE(second->data() == first->data());
+	REQUIRE(reader_b.peek() == '"');
+	REQUIRE(b == R"("caf\u00e9")"); // hit doesn't touch input
+
+	const auto third = cache.intern(R"("caf\u00e9")"sv);
+	REQUIRE(third.has_value());
+	REQUIRE(third->data() == first->data());
+
+	// same normalized value but different raw form is a different entry
+	const auto fourth = cache.intern(R"("café")"sv);
+	REQUIRE(fourth.has_value());
+	REQUIRE(*fourth == "café");
+
+	REQUIRE_FALSE(cache.intern("nope"sv).has_value());
+	REQUIRE_THROWS_AS(cache.intern(R"("\x")"sv), std::invalid_argument);
+
+	REQUIRE(cache.size() == 2u);
+	REQUIRE(cache.stats().hits == 2u);
+	REQUIRE(cache.stats().misses == 3u);
+
+	// many threads interning same keys must get same canonical strings
+	const auto keys = generate_json_keys(500);
+	const auto samples = sample_keys(keys, 20'000);
+	auto shared = json::intern_cache{};
+
+	std::vector<std::vector<std::string_view>> results(8);
+	run_in_threads(8, [&](unsigned t) {
+		for (std::string_view key: samples) {
+			results[t].push_back(*shared.intern(key));
+		}
+	});
+
+	REQUIRE(shared.size() <= keys.size());
+	REQUIRE(shared.stats().hits + shared.stats().misses == 8u * samples.size());
+
+	for (size_t i = 0; i != samples.size(); ++i) {
+		auto copy = std::string(samples[i]);
+		REQUIRE(*normalize(copy) == results[0][i]);
+
+		for (const auto & r: results) {
+			REQUIRE(r[i].data() == results[0][i].data());
+		}
+	}
+
+	const unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+
+	BENCHMARK_ADVANCED("keys (normalize + allocate, all threads)")
+	(Catch::Benchmark::Chronometer meter) {
+		meter.measure([&] {
+			std::atomic<size_t> total{0};
+			run_in_threads(threads, [&](unsigned) {
+				std::string buffer;
+				size_t sum = 0;
+				for (std::string_view key: samples) {
+					buffer = key;
+					sum += std::string(*normalize(buffer)).size();
+				}
+				total += sum;
+			});
+			return total.load();
+		});
+	};
+
+	BENCHMARK_ADVANCED("keys (intern cache, all threads)")
+	(Catch::Benchmark::Chronometer meter) {
+		auto cache = json::intern_cache{};
+
+		meter.measure([&] {
+			std::atomic<size_t> total{0};
+			run_in_threads(threads, [&](unsigned) {
+				size_t sum = 0;
+				for (std::string_view key: samples) {
+					sum += cache.intern(key)->size();
+				}
+				total += sum;
+			});
+			return total.load();
+		});
+
+		const auto stats = cache.stats();
+		std::cout << "intern cache: " << cache.size() << " keys, hit rate " << (stats.hit_rate() * 100.0) << "%\n";
+	};
+}
+
+// reference two-pass transcoding from normalized utf-8
+template <typename CharT> std::basic_string<CharT> transcode(std::string_view utf8) {
+	std::basic_string<CharT> output(utf8.size(), CharT{0});
+	CharT * writer = output.data();
+
+	for (auto in = json::const_string_reader(utf8); !in.is_end();) {
+		json::write_codepoint(writer, json::read_utf8_codepoint(in, json::additional_length_of(static_cast<char8_t>(in.peek()))));
+	}
+
+	output.resize(static_cast<size_t>(std::distance(output.data(), writer)));
+	return output;
+}
+
+template <typename CharT> std::optional<std::basic_string_view<CharT>> normalize_to(std::string_view content, std::vector<CharT> & output) {
+	output.resize(content.size());
+	auto reader = json::const_string_reader(content);
+	return json::read_and_normalize_string(reader, std::span<CharT>(output));
+}
+
+TEST_CASE("utf-16 and utf-32 output") {
+	constexpr auto in = R"("hello there \n\r\t \uD83D\uDE00 ěščřž uff 😀\u2192\u2211\u0394aabbccdde\\ĚŠČŘŽÝ😀😀")"sv;
+
+	std::vector<char16_t> buffer16;
+	const auto val16 = normalize_to(in, buffer16);
+	REQUIRE(val16.has_value());
+	REQUIRE((*val16 == u"hello there \n\r\t 😀 ěščřž uff 😀→∑Δaabbccdde\\ĚŠČŘŽÝ😀😀"sv));
+
+	std::vector<char32_t> buffer32;
+	const auto val32 = normalize_to(in, buffer32);
+	REQUIRE(val32.has_value());
+	REQUIRE((*val32 == U"hello there \n\r\t 😀 ěščřž uff 😀→∑Δaabbccdde\\ĚŠČŘŽÝ😀😀"sv));
+
+	REQUIRE_FALSE(normalize_to("hello"sv, buffer16).has_value());
+	REQUIRE_THROWS_AS(normalize_to(R"("hello)"sv, buffer16), std::invalid_argument);
+	REQUIRE_THROWS_AS(normalize_to("\"\x80\""sv, buffer16), std::invalid_argument);
+	REQUIRE_THROWS_AS(normalize_to("\"\xC3\x41\""sv, buffer32), std::invalid_argument);
+
+	// values over U+10FFFF, overlong forms and encoded surrogates
+	REQUIRE_THROWS_AS(normalize_to("\"\xF4\x90\x80\x80\""sv, buffer16), std::invalid_argument);
+	REQUIRE_THROWS_AS(normalize_to("\"\xF7\xBF\xBF\xBF\""sv, buffer16), std::invalid_argument);
+	REQUIRE_THROWS_AS(normalize_to("\"\xF7\xBF\xBF\xBF\""sv, buffer32), std::invalid_argument);
+	REQUIRE_THROWS_AS(normalize_to("\"\xC0\xAF\""sv, buffer16), std::invalid_argument);
+	REQUIRE_THROWS_AS(normalize_to("\"\xE0\x80\xAF\""sv, buffer32), std::invalid_argument);
+	REQUIRE_THROWS_AS(normalize_to("\"\xF0\x8F\xBF\xBF\""sv, buffer16), std::invalid_argument);
+	REQUIRE_THROWS_AS(normalize_to("\"\xED\xA0\x80\""sv, buffer16), std::invalid_argument);
+	REQUIRE((*normalize_to("\"\xF4\x8F\xBF\xBF\xEF\xBF\xBF\""sv, buffer16) == u"\U0010FFFF\uFFFF"sv));
+
+	// utf-8 output only checks continuation bytes, so these sequences are copied there but rejected here
+	for (const auto invalid: {"\"\xED\xA0\x80\""sv, "\"\xC0\xAF\""sv, "\"\xF4\x90\x80\x80\""sv}) {
+		auto copy = std::string(invalid);
+		REQUIRE(normalize(copy) == invalid.substr(1u, invalid.size() - 2u));
+		REQUIRE(json::equals_escaped(invalid, invalid.substr(1u, invalid.size() - 2u)));
+		REQUIRE_THROWS_WITH(normalize_to(invalid, buffer16), "invalid utf8");
+		REQUIRE_THROWS_WITH(normalize_to(invalid, buffer32), "invalid utf8");
+		REQUIRE_THROWS_WITH(std::ranges::distance(*json::code_points(invalid)), "invalid utf8");
+	}
+
+	// same as normalizing to utf-8 and transcoding
+	for (int i = 0; i != 100; ++i) {
+		auto str = generate_random_json_string_with_length(1000);
+		const auto direct16 = normalize_to(str, buffer16);
+		const auto direct32 = normalize_to(str, buffer32);
+		const auto utf8 = normalize(str);
+
+		REQUIRE(direct16.has_value());
+		REQUIRE(direct32.has_value());
+		REQUIRE(utf8.has_value());
+		REQUIRE(*direct16 == transcode<char16_t>(*utf8));
+		REQUIRE(*direct32 == transcode<char32_t>(*utf8));
+	}
+
+	BENCHMARK_ADVANCED("1MB to utf-16 (normalize + transcode)")
+	(Catch::Benchmark::Chronometer meter) {
+		std::vector<std::string> v(meter.runs());
+		std::fill(v.begin(), v.end(), generate_random_json_string_with_length(1024 * 1024));
+
+		meter.measure([&](int i) {
+			const auto out = normalize(v[i]);
+			REQUIRE(out.has_value());
+			return transcode<char16_t>(*out);
+		});
+	};
+
+	BENCHMARK_ADVANCED("1MB to utf-16 (direct)")
+	(Catch::Benchmark::Chronometer meter) {
+		const auto str = generate_random_json_string_with_length(1024 * 1024);
+
+		meter.measure([&] {
+			std::vector<char16_t> output;
+			const auto out = normalize_to(str, output);
+			REQUIRE(out.has_value());
+			return output;
+		});
+	};
+}
+
+TEST_CASE("code points") {
+	static_assert(std::ranges::input_range<json::code_point_view>);
+	static_assert(std::ranges::view<json::code_point_view>);
+	static_assert(std::ranges::distance(*json::code_points(R"("a\u00E1\uD83D\uDE00")"sv)) == 3);
+
+	constexpr auto in = R"("hello there \n\r\t \uD83D\uDE00 ěščřž uff 😀\u2192\u2211\u0394aabbccdde\\ĚŠČŘŽÝ😀😀")"sv;
+
+	const auto view = json::code_points(in);
+	REQUIRE(view.has_value());
+
+	std::u32string result;
+	std::ranges::copy(*view, std::back_inserter(result));
+	REQUIRE((result == U"hello there \n\r\t 😀 ěščřž uff 😀→∑Δaabbccdde\\ĚŠČŘŽÝ😀😀"sv));
+
+	REQUIRE_FALSE(json::code_points("hello"sv).has_value());
+	REQUIRE(std::ranges::distance(*json::code_points(R"("")"sv)) == 0);
+
+	// early exit doesn't look at the rest (which is invalid here)
+	const auto broken = json::code_points(R"("abc\x")"sv);
+	REQUIRE(*std::ranges::find(*broken, U'b') == U'b');
+	REQUIRE_THROWS_AS(std::ranges::distance(*broken), std::invalid_argument);
+	REQUIRE_THROWS_AS(std::ranges::distance(*json::code_points(R"("abc)"sv)), std::invalid_argument);
+
+	// only valid code points are produced
+	REQUIRE_THROWS_AS(std::ranges::distance(*json::code_points("\"\xF7\xBF\xBF\xBF\""sv)), std::invalid_argument);
+	REQUIRE_THROWS_AS(std::ranges::distance(*json::code_points("\"\xF4\x90\x80\x80\""sv)), std::invalid_argument);
+	REQUIRE_THROWS_AS(std::ranges::distance(*json::code_points("\"\xED\xBF\xBF\""sv)), std::invalid_argument);
+	REQUIRE_THROWS_AS(std::ranges::distance(*json::code_points(R"("\u00E)"sv)), std::invalid_argument);
+	REQUIRE_THROWS_AS(std::ranges::distance(*json::code_points(R"("\)"sv)), std::invalid_argument);
+
+	// same as normalize and decode
+	for (int i = 0; i != 100; ++i) {
+		auto str = generate_random_json_string_with_length(1000);
+		std::u32string lazy;
+		std::ranges::copy(*json::code_points(str), std::back_inserter(lazy));
+
+		REQUIRE(lazy == transcode<char32_t>(*normalize(str)));
+	}
+
+	BENCHMARK_ADVANCED("1MB code points (normalize + decode)")
+	(Catch::Benchmark::Chronometer meter) {
+		std::vector<std::string> v(meter.runs());
+		std::fill(v.begin(), v.end(), generate_random_json_string_with_length(1024 * 1024));
+
+		meter.measure([&](int i) {
+			const auto out = normalize(v[i]);
+			REQUIRE(out.has_value());
+
+			char32_t sum = 0;
+			for (auto in = json::const_string_reader(*out); !in.is_end();) {
+				sum += json::read_utf8_codepoint(in, json::additional_length_of(static_cast<char8_t>(in.peek())));
+			}
+			return sum;
+		});
+	};
+
+	BENCHMARK_ADVANCED("1MB code points (lazy view)")
+	(Catch::Benchmark::Chronometer meter) {
+		const auto str = generate_random_json_string_with_length(1024 * 1024);
+
+		meter.measure([&] {
+			char32_t sum = 0;
+			for (char32_t cp: *json::code_points(str)) {
+				sum += cp;
+			}
+			return sum;
+		});
+	};
+}
+
+TEST_CASE("compile-time literals") {
+	using namespace json::literals;
+
+	constexpr auto simple = json::normalize_literal<"hello">();
+	static_assert(simple.size() == 5u);
+	static_assert(simple == json::fixed_string("hello"));
+
+	constexpr auto escaped = json::normalize_literal<R"(Mil\u00E1nek \uD83D\uDC76\n\"\\\/)">();
+	static_assert(escaped.view() == "Milánek 👶\n\"\\/"sv);
+	static_assert(escaped.size() == escaped.view().size());
+	static_assert(escaped.c_str()[escaped.size()] == '\0');
+
+	static_assert(R"(caf\u00e9)"_json_str.view() == "café"sv);
+	static_assert(""_json_str.size() == 0u);
+
+	// can be used for compile-time key matching
+	static constexpr auto name = R"(na\u006De)"_json_str;
+	static constexpr auto created_at = R"(created\u005Fat)"_json_str;
+	static constexpr auto keys = json::make_key_set(name, created_at, "id");
+	static_assert(keys.find("name") == 0u);
+	static_assert(keys.find("created_at") == 1u);
+
+	REQUIRE(name.view() == "name");
+	REQUIRE(std::string_view(created_at) == "created_at");
+
+	// unterminated content is reported by the normalizer (which is also the compile error of a literal)
+	std::array<char, 6> buffer{};
+	REQUIRE_THROWS_WITH(json::normalize_literal_into(json::fixed_string(R"(abc\)"), buffer), "unexpected end");
+}
+
+TEST_CASE("short strings") {
+	// quote found in first load, after escape or non-ascii, or not at all
+	for (size_t length = 0; length != 40; ++length) {
+		for (const auto & filler: {"a"sv, "\\n"sv, "\xC3\xA1"sv}) {
+			std::string content;
+			std::string expected;
+			for (size_t i = 0; i != length; ++i) {
+				content += (i % 7 == 3) ? filler : "x"sv;
+				expected += (i % 7 == 3) ? (filler == "\\n" ? "\n"sv : filler) : "x"sv;
+			}
+
+			// something must follow the string and stay untouched
+			std::string str = "\"" + content + "\":{\"next\":1234567890123456789}";
+			const auto rest = str.substr(content.size() + 1u);
+
+			auto reader = json::string_reader(str);
+			const auto out = json::read_and_normalize_string(reader);
+			REQUIRE(out.has_value());
+			REQUIRE(*out == expected);
+			REQUIRE(reader.peek() == '"');
+			REQUIRE(std::string_view(reader.current, reader.end) == rest);
+
+			// into separate output
+			const std::string original = "\"" + content + "\":{\"next\":1234567890123456789}";
+			std::string input = original;
+			std::vector<char> output(input.size());
+			auto separate = json::string_reader(input);
+			const auto out2 = json::read_and_normalize_string(separate, std::span<char>(output));
+			REQUIRE(out2.has_value());
+			REQUIRE(*out2 == expected);
+			REQUIRE(out2->data() == output.data());
+			REQUIRE(input == original);
+			REQUIRE(std::string_view(separate.current, separate.end) == rest);
+		}
+	}
+
+	// separate output doesn't have to be initialized
+	constexpr auto into_uninitialized = [] {
+		char input[] = R"("short key": {"next": 1234567890})";
+		char output[40];
+		auto reader = json::string_reader(std::span<char>(input, sizeof(input) - 1u));
+		const auto out = json::read_and_normalize_string(reader, std::span<char>(output));
+		return out.has_value() && *out == "short key"sv && reader.peek() == '"';
+	};
+	static_assert(into_uninitialized());
+	REQUIRE(into_uninitialized());
+
+	const auto keys = generate_json_keys(300);
+	const auto samples = sample_keys(keys, 10'000);
+
+	BENCHMARK_ADVANCED("10k keys (realistic length distribution)")
+	(Catch::Benchmark::Chronometer meter) {
+		// keys are followed by rest of the document as in real input
+		std::vector<std::vector<std::string>> v(meter.runs());
+		for (auto & run: v) {
+			for (std::string_view key: samples) {
+				run.push_back(std::string(key) + R"(: "value", "next": 42)");
+			}
+		}
+
+		meter.measure([&](int i) {
+			size_t sum = 0;
+			for (std::string & key: v[i]) {
+				sum += normalize(key)->size();
+			}
+			return sum;
+		});
+	};
+}
+
+TEST_CASE("large strings") {
+	constexpr auto in = R"(hello there \n\r\t \uD83D\uDE00 ěščřž uff 😀\u2192\u2211\u0394aabbccdde\\ĚŠČŘŽÝ😀😀)"sv;
+
+	// streaming from any point must give same result in place, into separate buffer and with observer
+	const auto inputs = std::array{repeat(in, 1000), repeat(std::string(1000, 'x'), 10), generate_random_json_string_with_length(100'000)};
+
+	for (const std::string & input: inputs) {
+		auto copy = input;
+		const auto expected = std::string(*normalize(copy));
+
+		for (size_t threshold: {size_t{0}, size_t{1}, size_t{100}, size_t{4095}, std::numeric_limits<size_t>::max()}) {
+			auto in_place = input;
+			auto reader = json::string_reader(in_place);
+			const auto a = json::read_and_normalize_string(reader, reader.writable_rest(), json::no_observer{}, threshold);
+			REQUIRE(a == expected);
+
+			auto source = input;
+			std::vector<char> output(source.size() + 7u);
+			for (size_t offset = 0; offset != 8u; ++offset) {
+				auto separate = json::string_reader(source);
+				const auto b = json::read_and_normalize_string(separate, std::span<char>(output).subspan(offset, source.size()), json::no_observer{}, threshold);
+				REQUIRE(b == expected);
+			}
+
+			auto hashed = input;
+			auto hashed_reader = json::string_reader(hashed);
+			auto hasher = json::string_hasher{};
+			const auto c = json::read_and_normalize_string(hashed_reader, hashed_reader.writable_rest(), hasher, threshold);
+			REQUIRE(c == expected);
+			REQUIRE(hasher.finalize() == json::hash_string(expected));
+		}
+	}
+
+	// large inputs are built only when benchmarks run
+	const auto benchmark_into_output = [&](Catch::Benchmark::Chronometer & meter, size_t megabytes, const std::string & name, size_t threshold) {
+		// input is not modified when output is a separate buffer
+		auto source = repeat(in, static_cast<int>(megabytes * 1024u * 1024u / 100u));
+		std::vector<char> output(source.size());
+
+		const auto normalize_into_output = [&] {
+			auto reader = json::string_reader(source);
+			const auto out = json::read_and_normalize_string(reader, std::span<char>(output), json::no_observer{}, threshold);
+			REQUIRE(out.has_value());
+			return out->size();
+		};
+
+		report_throughput(name, source.size(), normalize_into_output);
+		meter.measure(normalize_into_output);
+	};
+
+	for (const size_t megabytes: {10u, 64u}) {
+		const auto name = std::to_string(megabytes) + "MB into separate buffer";
+
+		BENCHMARK_ADVANCED(name + " (regular stores)")
+		(Catch::Benchmark::Chronometer meter) {
+			benchmark_into_output(meter, megabytes, name + " (regular stores)", std::numeric_limits<size_t>::max());
+		};
+
+		BENCHMARK_ADVANCED(name + " (streaming)")
+		(Catch::Benchmark::Chronometer meter) {
+			benchmark_into_output(meter, megabytes, name + " (streaming)", json::default_large_string_threshold);
+		};
+	}
+}
+
+#ifdef __linux__
+TEST_CASE("socket ingestion") {
+	// complete strings are normalized in place, unfinished one up to its incomplete tail
+	{
+		std::string buffer = "\"a\\u00e1\"\n \"b\" \"unfinished \\u00";
+		std::vector<std::string> strings;
+		auto collect = [&](std::string_view str) { strings.emplace_back(str); };
+
+		auto normalizer = json::stream_normalizer{};
+		const size_t rest = normalizer.normalize_available(std::span<char>(buffer), collect);
+		REQUIRE(strings == std::vector<std::string>{"aá", "b"});
+		REQUIRE(std::string_view(buffer.data(), rest) == "\\u00");
+		REQUIRE(normalizer.is_inside_string());
+
+		buffer.replace(rest, std::string::npos, "E9 and more\" ");
+		REQUIRE(normalizer.normalize_available(std::span<char>(buffer), collect) == 0u);
+		REQUIRE(strings == std::vector<std::string>{"aá", "b", "unfinished é and more"});
+		REQUIRE_FALSE(normalizer.is_inside_string());
+
+		std::string wrong = "\"a\" b";
+		REQUIRE_THROWS_AS(json::stream_normalizer{}.normalize_available(std::span<char>(wrong), collect), std::invalid_argument);
+	}
+
+	// any split of the stream into chunks gives the same strings
+	{
+		constexpr auto piece = R"("hello there \n\r\t \uD83D\uDE00 ěščřž uff 😀\u2192\u2211\u0394aabbccdde\\ĚŠČŘŽÝ😀😀" )"sv;
+		const auto stream = std::string(piece) + generate_random_json_string_with_length(300) + "\n" + std::string(piece) + "\"\"";
+
+		std::vector<std::string> expected;
+		for (auto in = json::const_string_reader(std::string_view(stream)); !in.is_end();) {
+			while (!in.is_end() && json::is_json_whitespace(in.peek())) {
+				in.next();
+			}
+			const auto raw = *json::read_raw_string(in);
+			in.next();
+
+			auto copy = "\"" + std::string(raw) + "\"";
+			expected.emplace_back(*normalize(copy));
+		}
+		REQUIRE(expected.size() == 4u);
+
+		for (size_t chunk_size: {1u, 2u, 3u, 5u, 7u, 11u, 13u, 64u, 1000u}) {
+			std::vector<std::string> strings;
+			auto collect = [&](std::string_view str) { strings.emplace_back(str); };
+
+			auto normalizer = json::stream_normalizer{};
+			std::string buffer;
+
+			for (size_t offset = 0; offset < stream.size(); offset += chunk_size) {
+				buffer += stream.substr(offset, chunk_size);
+				buffer.resize(normalizer.normalize_available(std::span<char>(buffer), collect));
+				REQUIRE(buffer.size() <= 12u);
+			}
+
+			REQUIRE(buffer.empty());
+			REQUIRE_FALSE(normalizer.is_inside_string());
+			REQUIRE(strings == expected);
+		}
+	}
+
+	// strings arriving in small pieces over many connections
+	constexpr int connections = 16;
+	constexpr auto message = R"("hello there \n\r\t \uD83D\uDE00 ěščřž uff 😀\u2192\u2211\u0394aabbccdde\\ĚŠČŘŽÝ😀😀")"sv;
+	constexpr auto expected = "hello there \n\r\t 😀 ěščřž uff 😀→∑Δaabbccdde\\ĚŠČŘŽÝ😀😀"sv;
+
+	auto loop = json::event_loop{};
+	std::vector<std::array<int, 2>> sockets(connections);
+	std::vector<std::vector<std::string>> received(connections);
+	std::vector<int> closed(connections, 0);
+
+	for (int c = 0; c != connections; ++c) {
+		REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets[c].data()) == 0);
+		json::ingest_strings(
+			loop, sockets[c][0], [&, c](std::string_view str) { received[c].emplace_back(str); }, [&, c](std::exception_ptr error) { closed[c] = error ? -1 : 1; }, 256u);
+	}
+
+	// last connections send string which is longer than buffer and invalid input (catch's assertions are not thread-safe, so it's checked at the end)
+	bool all_written = true;
+	std::jthread sender([&] {
+		std::string all;
+		for (int i = 0; i != 10; ++i) {
+			all += message;
+			all += "\n";
+		}
+
+		for (size_t offset = 0; offset < all.size(); offset += 7u) {
+			for (int c = 0; c != connections - 2; ++c) {
+				const auto piece = std::string_view(all).substr(offset, 7u);
+				all_written &= (write(sockets[c][1], piece.data(), piece.size()) == static_cast<ssize_t>(piece.size()));
+			}
+			std::this_thread::yield();
+		}
+
+		const auto long_string = "\"" + std::string(300, 'x') + "\\u00E1\" ";
+		all_written &= (write(sockets[connections - 2][1], long_string.data(), long_string.size()) == static_cast<ssize_t>(long_string.size()));
+
+		const auto unfinished = "\"" + std::string(300, 'x');
+		all_written &= (write(sockets[connections - 1][1], unfinished.data(), unfinished.size()) == static_cast<ssize_t>(unfinished.size()));
+
+		for (const auto & pair: sockets) {
+			close(pair[1]);
+		}
+	});
+
+	loop.run();
+	sender.join();
+	REQUIRE(all_written);
+
+	for (int c = 0; c != connections - 2; ++c) {
+		REQUIRE(closed[c] == 1);
+		REQUIRE(received[c].size() == 10u);
+		for (const auto & str: received[c]) {
+			REQUIRE(str == expected);
+		}
+	}
+
+	REQUIRE(closed[connections - 2] == 1);
+	REQUIRE(received[connections - 2] == std::vector<std::string>{std::string(300, 'x') + "á"});
+
+	REQUIRE(closed[connections - 1] == -1);
+	REQUIRE(received[connections - 1].empty());
+
+	for (const auto & pair: sockets) {
+		close(pair[0]);
+	}
+}
+#endif
+
+TEST_CASE("case folding") {
+	constexpr auto in = R"("HeLLo \u0041BC ÀÉÎ×ČŘŽĹĽŊ Ÿ ſ µ ß İ \u00C9\u0178 ZZZZZZZZZZZZZZZZZZZZZZZZ")"sv;
+
+	const auto fold = [](std::string_view content, auto fold_type, size_t threshold = json::default_large_string_threshold) {
+		auto str = std::string(content);
+		auto reader = json::string_reader(str);
+		const auto out = json::read_and_normalize_string<false, decltype(fold_type)::value>(reader, reader.writable_rest(), json::no_observer{}, threshold);
+		REQUIRE(out.has_value());
+		return std::string(*out);
+	};
+
+	using ascii = std::integral_constant<json::case_folding, json::case_folding::ascii>;
+	using latin = std::integral_constant<json::case_folding, json::case_folding::latin>;
+
+	REQUIRE(fold(in, ascii{}) == "hello abc ÀÉÎ×ČŘŽĹĽŊ Ÿ ſ µ ß İ ÉŸ zzzzzzzzzzzzzzzzzzzzzzzz");
+	REQUIRE(fold(in, latin{}) == "hello abc àéî×čřžĺľŋ ÿ s μ ß İ éÿ zzzzzzzzzzzzzzzzzzzzzzzz");
+	REQUIRE(fold(in, latin{}, 0u) == "hello abc àéî×čřžĺľŋ ÿ s μ ß İ éÿ zzzzzzzzzzzzzzzzzzzzzzzz");
+
+	std::string short_key = R"("Content-TYPE": 1234567890)";
+	auto reader = json::string_reader(short_key);
+	REQUIRE(json::read_and_normalize_folded_string<json::case_folding::ascii>(reader) == "content-type");
+	REQUIRE(short_key == R"(content-typeE": 1234567890)");
+
+	// every ascii byte in every path (short, loop, streaming) is same as separate lowercase pass
+	std::string all_ascii = "\"";
+	for (int i = 0; i != 4; ++i) {
+		for (char c = ' '; c != 0x7F; ++c) {
+			if (c != '"' && c != '\\') {
+				all_ascii += c;
+			}
+		}
+	}
+	all_ascii += "\"";
+
+	for (const auto & str: {all_ascii, generate_random_json_string_with_length(10'000)}) {
+		auto copy = str;
+		auto expected = std::string(*normalize(copy));
+		std::transform(expected.begin(), expected.end(), expected.begin(), [](char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 0x20) : c; });
+
+		REQUIRE(fold(str, ascii{}) == expected);
+		REQUIRE(fold(str, ascii{}, 0u) == expected);
+	}
+
+	// latin folding of every code point up to U+024F
+	for (char32_t cp = 0x20u; cp != 0x250u; ++cp) {
+		if (cp == '"' || cp == '\\') {
+			continue;
+		}
+
+		std::string str = "\"";
+		auto out = std::back_inserter(str);
+		std::array<char, 4> buffer{};
+		char * it = buffer.data();
+		json::write_as_utf8_codepoint_with_branch(it, cp);
+		std::copy(buffer.data(), it, out);
+		str += "\"";
+
+		const auto folded = fold(str, latin{});
+		const auto decoded = transcode<char32_t>(folded);
+		REQUIRE(decoded.size() == 1u);
+		REQUIRE(decoded[0] == json::fold_code_point<json::case_folding::latin>(cp));
+	}
+
+	// escapes must stay as they are
+	const auto uppercase_key = [](std::string_view key) {
+		auto upper = std::string(key);
+		for (size_t i = 0; i != upper.size(); ++i) {
+			if (upper[i] == '\\') {
+				i += (upper[i + 1u] == 'u') ? 5u : 1u;
+			} else if (upper[i] >= 'a' && upper[i] <= 'z') {
+				upper[i] = static_cast<char>(upper[i] - 0x20);
+			}
+		}
+		return upper;
+	};
+
+	const auto keys = generate_json_keys(300);
+
+	// folded keys are same as lowercase keys and observer sees the folded output
+	for (std::string_view key: keys) {
+		auto lower = std::string(key);
+		const auto expected = std::string(*normalize(lower));
+
+		auto upper = uppercase_key(key);
+		auto reader = json::string_reader(upper);
+		auto hasher = json::string_hasher{};
+		REQUIRE(json::read_and_normalize_string<false, json::case_folding::ascii>(reader, reader.writable_rest(), hasher) == expected);
+		REQUIRE(hasher.finalize() == json::hash_string(expected));
+	}
+
+	auto samples = std::vector<std::string>();
+	for (std::string_view key: sample_keys(keys, 10'000)) {
+		samples.push_back(uppercase_key(key) + R"(: "value", "next": 42)");
+	}
+
+	BENCHMARK_ADVANCED("10k keys (normalize + lowercase)")
+	(Catch::Benchmark::Chronometer meter) {
+		std::vector<std::vector<std::string>> v(meter.runs(), samples);
+
+		meter.measure([&](int i) {
+			size_t sum = 0;
+			for (std::string & key: v[i]) {
+				const auto out = normalize(key);
+				char * first = key.data() + std::distance(const_cast<const char *>(key.data()), out->data());
+				std::transform(first, first + out->size(), first, [](char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 0x20) : c; });
+				sum += out->size();
+			}
+			return sum;
+		});
+	};
+
+	BENCHMARK_ADVANCED("10k keys (folded)")
+	(Catch::Benchmark::Chronometer meter) {
+		std::vector<std::vector<std::string>> v(meter.runs(), samples);
+
+		meter.measure([&](int i) {
+			size_t sum = 0;
+			for (std::string & key: v[i]) {
+				auto reader = json::string_reader(key);
+				sum += json::read_and_normalize_folded_string<json::case_folding::ascii>(reader)->size();
+			}
+			return sum;
+		});
+	};
+}
+
 TEST_CASE("basics (branchless)") {
 	auto normalize = [](std::string & content) {
 		auto reader = json::string_reader(content);